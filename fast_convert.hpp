@@ -1,7 +1,11 @@
 #ifndef FAST_CONVERT_HPP
 #define FAST_CONVERT_HPP
 
-#include "astring_view.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
 
 namespace xts
 {
@@ -15,6 +19,167 @@ namespace xts
 		}
 		return result;
 	}
+
+	enum class convert_status : std::uint8_t
+	{
+		ok,
+		empty,
+		invalid_digit,
+		overflow
+	};
+
+	//Parse decimal digits only, without sign nor space, into a value not above max
+	//Nothing is thrown nor allocated, value is only written on success
+	template <typename UINT, typename CHAR>
+	constexpr convert_status parse_uint(std::basic_string_view<CHAR> str, UINT& value, UINT max = (std::numeric_limits<UINT>::max)())
+	{
+		if (str.empty())
+			return convert_status::empty;
+
+		UINT result = 0;
+		for (CHAR c : str)
+		{
+			if (c < '0' || c > '9')
+				return convert_status::invalid_digit;
+			UINT digit = static_cast<UINT>(c - '0');
+			if (result > (max - digit) / 10)
+				return convert_status::overflow;
+			result = result * 10 + digit;
+		}
+		value = result;
+		return convert_status::ok;
+	}
+
+	//Parse a dotted decimal IPv4 address as per RFC 3986 dec-octet, leading zeros are rejected
+	//The first octet is stored in the most significant byte of address
+	template <typename CHAR>
+	constexpr convert_status parse_ipv4(std::basic_string_view<CHAR> str, std::uint32_t& address)
+	{
+		std::uint32_t result = 0;
+		for (std::size_t octet = 0; octet < 4; ++octet)
+		{
+			std::size_t end = octet < 3 ? str.find('.') : str.size();
+			if (end == std::basic_string_view<CHAR>::npos)
+				return convert_status::invalid_digit;
+
+			std::basic_string_view<CHAR> digits = str.substr(0, end);
+			std::uint8_t value = 0;
+			convert_status status = parse_uint<std::uint8_t>(digits, value);
+			if (status != convert_status::ok)
+				return status;
+			if (digits.size() > 1 && digits[0] == '0')
+				return convert_status::invalid_digit;
+
+			result = (result << 8) | value;
+			str.remove_prefix(octet < 3 ? end + 1 : end);
+		}
+		address = result;
+		return convert_status::ok;
+	}
+	typedef std::array<std::uint8_t, 4> ipv4_address;
+	typedef std::array<std::uint8_t, 16> ipv6_address;
+
+	//Same as above, the bytes are in network order as in in_addr
+	template <typename CHAR>
+	constexpr convert_status parse_ipv4(std::basic_string_view<CHAR> str, ipv4_address& address)
+	{
+		std::uint32_t value = 0;
+		convert_status status = parse_ipv4(str, value);
+		if (status == convert_status::ok)
+		{
+			for (std::size_t i = 0; i < 4; ++i)
+				address[i] = static_cast<std::uint8_t>(value >> (24 - 8 * i));
+		}
+		return status;
+	}
+
+	//Parse an IPv6 address as per RFC 4291 2.2, without brackets nor zone
+	//Accept one "::" and a dotted IPv4 in the last 32 bits, the bytes are in network order as in in6_addr
+	template <typename CHAR>
+	constexpr convert_status parse_ipv6(std::basic_string_view<CHAR> str, ipv6_address& address)
+	{
+		auto hex = [](CHAR c) -> int {
+			if (c >= '0' && c <= '9')
+				return c - '0';
+			if (c >= 'a' && c <= 'f')
+				return c - 'a' + 10;
+			if (c >= 'A' && c <= 'F')
+				return c - 'A' + 10;
+			return -1;
+		};
+
+		if (str.empty())
+			return convert_status::empty;
+
+		std::uint8_t bytes[16] = {};
+		std::size_t count = 0;
+		std::size_t compress = 16;
+		if (str.size() >= 2 && str[0] == ':' && str[1] == ':')
+		{
+			compress = 0;
+			str.remove_prefix(2);
+		}
+
+		while (!str.empty())
+		{
+			if (count == 16)
+				return convert_status::overflow;
+
+			std::size_t digits = 0;
+			std::uint32_t group = 0;
+			for (; digits < str.size() && digits < 5 && hex(str[digits]) >= 0; ++digits)
+				group = group * 16 + static_cast<std::uint32_t>(hex(str[digits]));
+
+			if (digits < str.size() && str[digits] == '.')
+			{
+				if (count > 12)
+					return convert_status::overflow;
+				std::uint32_t value = 0;
+				convert_status status = parse_ipv4(str, value);
+				if (status != convert_status::ok)
+					return status;
+				for (std::size_t i = 0; i < 4; ++i)
+					bytes[count++] = static_cast<std::uint8_t>(value >> (24 - 8 * i));
+				str = std::basic_string_view<CHAR>();
+				break;
+			}
+			if (digits == 0)
+				return convert_status::invalid_digit;
+			if (digits > 4)
+				return convert_status::overflow;
+
+			bytes[count++] = static_cast<std::uint8_t>(group >> 8);
+			bytes[count++] = static_cast<std::uint8_t>(group);
+			str.remove_prefix(digits);
+			if (str.empty())
+				break;
+			if (str[0] != ':' || str.size() == 1)
+				return convert_status::invalid_digit;
+			str.remove_prefix(1);
+			if (str[0] == ':')
+			{
+				if (compress != 16)
+					return convert_status::invalid_digit;
+				compress = count;
+				str.remove_prefix(1);
+			}
+		}
+
+		if (compress == 16 ? count != 16 : count > 14)
+			return convert_status::invalid_digit;
+
+		std::size_t gap = 16 - count;
+		for (std::size_t i = 0; i < 16; ++i)
+		{
+			if (i < compress || compress == 16)
+				address[i] = bytes[i];
+			else if (i < compress + gap)
+				address[i] = 0;
+			else
+				address[i] = bytes[i - gap];
+		}
+		return convert_status::ok;
+	}
 }
 
 #endif //FAST_CONVERT_HPP
@@ -3,55 +3,125 @@
 
 #include <string_view>
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "fast_convert.hpp"
+#include "uri_delimiters.hpp"
 
 namespace xts
 {
-// Read only container to handle the path, query & fragment part of uri
+// Forward iterator over the segments of a basic_uri_tokenizer
+// The next delimitor is only searched when the iterator is incremented, from
+// the delimiter_mask of the current block
 template <typename CHAR_CONTAINER, CHAR_CONTAINER DELIMITOR>
-class basic_uri_tokenizer
+class basic_uri_token_iterator
 {
 public:
-   typedef std::basic_string<CHAR_CONTAINER> string_type;
    typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
-   typedef std::vector<string_view_type> cutted_vector_type;
+   typedef std::forward_iterator_tag iterator_category;
    typedef string_view_type value_type;
-   typedef string_view_type* pointer;
-   typedef string_view_type& reference;
-   typedef const string_view_type& const_reference;
-   typedef typename cutted_vector_type::iterator iterator;
-   typedef typename cutted_vector_type::const_iterator const_iterator;
+   typedef std::ptrdiff_t difference_type;
+   typedef const string_view_type* pointer;
+   typedef const string_view_type& reference;
 
 private:
-   const string_view_type _data;
-   const cutted_vector_type _cutted;
+   typedef basic_delimiter_scanner<CHAR_CONTAINER, DELIMITOR> scanner_type;
 
-   static cutted_vector_type cut_data(const string_view_type& data)
+   scanner_type _scanner;
+   std::size_t _pos = 0;
+   string_view_type _current;
+
+   void cut()
    {
-      cutted_vector_type result;
-      auto beg = data.begin();
-      auto end = data.end();
-      while (beg != end)
+      const string_view_type& data = _scanner.data();
+      if (_pos == data.size())
       {
-         if (*beg == DELIMITOR)
-            ++beg;
+         _current = string_view_type();
+         return;
+      }
 
-         auto finded = std::find(beg, end, DELIMITOR);
-         if (finded != end)
-         {
-            result.push_back(data.substr(std::distance(data.begin(), beg), std::distance(beg, finded)));
-         }
-         else
-         {
-            result.push_back(data.substr(std::distance(data.begin(), beg)));
-         }
-         beg = finded;
+      auto beg = _pos;
+      if (data[beg] == DELIMITOR)
+      {
+         _scanner.pop();
+         ++beg;
       }
+
+      auto finded = _scanner.peek();
+      _current = data.substr(beg, finded - beg);
+   }
+
+public:
+   basic_uri_token_iterator() = default;
+   basic_uri_token_iterator(const basic_uri_token_iterator&) = default;
+   basic_uri_token_iterator(basic_uri_token_iterator&&) = default;
+   ~basic_uri_token_iterator() = default;
+   basic_uri_token_iterator& operator=(const basic_uri_token_iterator&) = default;
+   basic_uri_token_iterator& operator=(basic_uri_token_iterator&&) = default;
+
+   // pos is either 0 for the first segment or data.size() for the end
+   basic_uri_token_iterator(const string_view_type& data, std::size_t pos)
+       : _scanner(data, pos), _pos(pos)
+   {
+      cut();
+   }
+
+   reference operator*() const { return _current; }
+   pointer operator->() const { return &_current; }
+
+   basic_uri_token_iterator& operator++()
+   {
+      _pos = static_cast<std::size_t>(
+          _current.data() + _current.size() - _scanner.data().data());
+      cut();
+      return *this;
+   }
+
+   basic_uri_token_iterator operator++(int)
+   {
+      basic_uri_token_iterator result = *this;
+      ++(*this);
       return result;
    }
 
+   bool operator==(const basic_uri_token_iterator& rhs) const
+   {
+      return _pos == rhs._pos
+          && _scanner.data().data() == rhs._scanner.data().data();
+   }
+
+   bool operator!=(const basic_uri_token_iterator& rhs) const
+   {
+      return !operator==(rhs);
+   }
+};
+
+// Read only container to handle the path, query & fragment part of uri
+// Segments are cut lazily while iterating, nothing is allocated
+template <typename CHAR_CONTAINER, CHAR_CONTAINER DELIMITOR>
+class basic_uri_tokenizer
+{
+public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef string_view_type value_type;
+   typedef const string_view_type* pointer;
+   typedef const string_view_type& reference;
+   typedef const string_view_type& const_reference;
+   typedef basic_uri_token_iterator<CHAR_CONTAINER, DELIMITOR> const_iterator;
+   typedef const_iterator iterator;
+
+private:
+   string_view_type _data;
+
 public:
    basic_uri_tokenizer() = default;
    basic_uri_tokenizer(const basic_uri_tokenizer&) = default;
@@ -60,15 +130,36 @@ public:
    basic_uri_tokenizer& operator=(const basic_uri_tokenizer&) = default;
    basic_uri_tokenizer& operator=(basic_uri_tokenizer&&) = default;
    basic_uri_tokenizer(const string_view_type& view)
-       : _data(view), _cutted(cut_data(view))
+       : _data(view)
    {
    }
 
    const string_view_type& data() const { return _data; }
    std::size_t data_size() const { return _data.size(); }
-   std::size_t size() const { return _cutted.size(); }
-   const_iterator begin() const { return _cutted.begin(); }
-   const_iterator end() const { return _cutted.end(); }
+   bool empty() const { return _data.empty(); }
+   const_iterator begin() const { return const_iterator(_data, 0); }
+   const_iterator end() const { return const_iterator(_data, _data.size()); }
+
+   // walk every segment, prefer empty() when possible
+   std::size_t size() const
+   {
+      return static_cast<std::size_t>(std::distance(begin(), end()));
+   }
+
+   // Copy the segments into a random access container, use a
+   // fixed::vector<string_view_type, N> to keep them inline
+   // Stop silently once max_size() segments are stored
+   template <typename CONTAINER>
+   CONTAINER split() const
+   {
+      CONTAINER result;
+      for (auto it = begin(); it != end() && result.size() < result.max_size();
+           ++it)
+      {
+         result.push_back(*it);
+      }
+      return result;
+   }
 
    bool operator==(const basic_uri_tokenizer& rhs) const
    {
@@ -76,9 +167,610 @@ public:
    }
 };
 
-// Read only implementation of URI | URL | URN, as per defined in RFC 3986
+// Split a query on '&' then on the first '=' of each pair, a leading '?' is
+// skipped and the empty pairs are dropped
+// callback(key, value) is given views on the query, the value of a pair
+// without '=' is empty and located at the end of its key
+template <typename CHAR_CONTAINER, typename CALLBACK>
+void for_each_query_pair(
+    std::basic_string_view<CHAR_CONTAINER> query, CALLBACK&& callback)
+{
+   typedef basic_delimiter_scanner<CHAR_CONTAINER, '&', '='> scanner_type;
 
-template <typename CHAR_CONTAINER> class basic_uri
+   if(!query.empty() && query.front() == '?')
+      query.remove_prefix(1);
+
+   scanner_type scanner(query);
+   std::size_t beg = 0;
+   std::size_t equal = query.size();
+   for(;;)
+   {
+      std::size_t d = scanner.peek();
+      if(d < query.size() && query[d] == '=')
+      {
+         if(equal == query.size())
+            equal = d;
+         scanner.pop();
+         continue;
+      }
+      if(d > beg)
+      {
+         if(equal < d)
+            callback(query.substr(beg, equal - beg),
+                query.substr(equal + 1, d - equal - 1));
+         else
+            callback(query.substr(beg, d - beg), query.substr(d, 0));
+      }
+      if(d >= query.size())
+         break;
+      scanner.pop();
+      beg = d + 1;
+      equal = query.size();
+   }
+}
+
+// Components of an uri, used as index in the uri_offsets table
+enum class uri_component : std::uint8_t
+{
+   scheme,
+   authority,
+   userinfo,
+   user,
+   password,
+   hostname,
+   port,
+   path,
+   query,
+   fragment,
+   count
+};
+
+// Kind of the host as per RFC 3986 3.2.2
+enum class uri_host_type : std::uint8_t
+{
+   none,
+   reg_name,
+   ipv4,
+   ipv6,
+   ipvfuture
+};
+
+// Classify a hostname component, IP literals keep their brackets
+template <typename CHAR_CONTAINER>
+constexpr uri_host_type classify_host(
+    std::basic_string_view<CHAR_CONTAINER> host)
+{
+   if(host.empty())
+      return uri_host_type::none;
+   if(host.front() == '[' && host.back() == ']' && host.size() > 2)
+   {
+      if(host[1] == 'v' || host[1] == 'V')
+         return uri_host_type::ipvfuture;
+      ipv6_address address{};
+      return parse_ipv6(host.substr(1, host.size() - 2), address)
+              == convert_status::ok
+          ? uri_host_type::ipv6
+          : uri_host_type::reg_name;
+   }
+   std::uint32_t address = 0;
+   return parse_ipv4(host, address) == convert_status::ok
+       ? uri_host_type::ipv4
+       : uri_host_type::reg_name;
+}
+
+// Position of one component inside the uri data
+struct uri_span
+{
+   std::uint32_t offset = 0;
+   std::uint32_t length = 0;
+
+   constexpr bool operator==(const uri_span& rhs) const
+   {
+      return offset == rhs.offset && length == rhs.length;
+   }
+   constexpr bool operator!=(const uri_span& rhs) const
+   {
+      return !operator==(rhs);
+   }
+};
+
+// Compact table of every component, computed once by parse_uri_offsets
+typedef std::array<uri_span, static_cast<std::size_t>(uri_component::count)>
+    uri_offsets;
+
+constexpr uri_span& span_of(uri_offsets& offsets, uri_component c)
+{
+   return offsets[static_cast<std::size_t>(c)];
+}
+
+constexpr const uri_span& span_of(
+    const uri_offsets& offsets, uri_component c)
+{
+   return offsets[static_cast<std::size_t>(c)];
+}
+
+// Components a parse must compute, the others are left empty
+// The parse stop once the last requested component is known: asking only
+// for the scheme and the hostname never scan the path nor the query
+template <uri_component... COMPONENTS> struct uri_parse_policy
+{
+   static constexpr std::uint32_t mask
+       = (0u | ... | (1u << static_cast<std::uint32_t>(COMPONENTS)));
+
+   static constexpr bool needs(uri_component c)
+   {
+      return ((mask >> static_cast<std::uint32_t>(c)) & 1u) != 0;
+   }
+
+   static constexpr bool needs_from(uri_component c)
+   {
+      return (mask >> static_cast<std::uint32_t>(c)) != 0;
+   }
+};
+
+typedef uri_parse_policy<uri_component::scheme, uri_component::authority,
+    uri_component::userinfo, uri_component::user, uri_component::password,
+    uri_component::hostname, uri_component::port, uri_component::path,
+    uri_component::query, uri_component::fragment>
+    full_uri_parse;
+
+// Split the uri in all its RFC 3986 components in a single pass
+// The structural delimitors are classified by block, only their positions
+// are visited
+// The query keep its leading '?' and the fragment its leading '#', as the
+// tokenizers expect them
+// SCANNER walks the delimitors, basic_constexpr_delimiter_scanner makes the
+// parse usable in constant expressions, see constexpr_parse_uri_offsets
+// POLICY select the components to compute, see partial_parse_uri_offsets
+template <typename CHAR_CONTAINER,
+    template <typename SCANNER_CHAR, SCANNER_CHAR...> class SCANNER
+    = basic_delimiter_scanner,
+    typename POLICY = full_uri_parse>
+constexpr uri_offsets parse_uri_offsets(
+    std::basic_string_view<CHAR_CONTAINER> data)
+{
+   typedef std::uint32_t pos_type;
+   typedef SCANNER<CHAR_CONTAINER, ':', '/', '?', '#', '@'> scanner_type;
+   uri_offsets result{};
+   const pos_type size = static_cast<pos_type>(data.size());
+   auto set = [&result](uri_component c, pos_type beg, pos_type end) {
+      if(POLICY::needs(c))
+         span_of(result, c) = uri_span{beg, end - beg};
+   };
+   scanner_type scanner(data);
+   auto next = [&scanner]() { return static_cast<pos_type>(scanner.peek()); };
+
+   // scheme, only if the ':' come before any other delimitor
+   pos_type pos = 0;
+   pos_type d = next();
+   while(d < size && data[d] == '@')
+   {
+      scanner.pop();
+      d = next();
+   }
+   if(d < size && data[d] == ':')
+   {
+      set(uri_component::scheme, 0, d);
+      scanner.pop();
+      pos = d + 1;
+   }
+   if(!POLICY::needs_from(uri_component::authority))
+      return result;
+
+   // authority
+   if(size - pos >= 2 && data[pos] == '/' && data[pos + 1] == '/')
+   {
+      const pos_type beg = pos + 2;
+      pos_type at = size;
+      pos_type first_colon = size;
+      pos_type host_colon = size;
+      scanner.seek(beg);
+      pos_type end = next();
+      for(; end < size; end = next())
+      {
+         auto c = data[end];
+         if(c == '/' || c == '?' || c == '#')
+            break;
+         if(c == '@' && at == size)
+         {
+            at = end;
+            host_colon = size;
+         }
+         else if(c == ':')
+         {
+            if(first_colon == size)
+               first_colon = end;
+            if(host_colon == size)
+               host_colon = end;
+         }
+         scanner.pop();
+      }
+
+      set(uri_component::authority, beg, end);
+      pos_type host_beg = beg;
+      if(at != size)
+      {
+         set(uri_component::userinfo, beg, at);
+         if(first_colon < at)
+         {
+            set(uri_component::user, beg, first_colon);
+            set(uri_component::password, first_colon + 1, at);
+         }
+         else
+         {
+            set(uri_component::user, beg, at);
+            set(uri_component::password, at, at);
+         }
+         host_beg = at + 1;
+      }
+      else
+      {
+         set(uri_component::userinfo, beg, beg);
+         set(uri_component::user, beg, beg);
+         set(uri_component::password, beg, beg);
+      }
+
+      // the colons of an IP literal are not the port delimitor
+      if(host_beg < end && data[host_beg] == '[')
+      {
+         const std::size_t close = data.substr(0, end).find(']', host_beg);
+         host_colon = close != data.npos && close + 1 < end
+                 && data[close + 1] == ':'
+             ? static_cast<pos_type>(close + 1)
+             : size;
+      }
+
+      if(host_colon != size)
+      {
+         set(uri_component::hostname, host_beg, host_colon);
+         set(uri_component::port, host_colon + 1, end);
+      }
+      else
+      {
+         set(uri_component::hostname, host_beg, end);
+         set(uri_component::port, end, end);
+      }
+      pos = end;
+   }
+   if(!POLICY::needs_from(uri_component::path))
+      return result;
+
+   // path, up to the query or the fragment
+   pos_type path_end = next();
+   while(path_end < size && data[path_end] != '?' && data[path_end] != '#')
+   {
+      scanner.pop();
+      path_end = next();
+   }
+   set(uri_component::path, pos, path_end);
+   if(!POLICY::needs_from(uri_component::query))
+      return result;
+
+   // query, keep its '?' up to the fragment
+   pos_type query_end = path_end;
+   if(query_end < size && data[query_end] == '?')
+   {
+      scanner.pop();
+      query_end = next();
+      while(query_end < size && data[query_end] != '#')
+      {
+         scanner.pop();
+         query_end = next();
+      }
+   }
+   set(uri_component::query, path_end, query_end);
+   if(!POLICY::needs_from(uri_component::fragment))
+      return result;
+
+   // fragment, keep its '#'
+   set(uri_component::fragment, query_end, size);
+   return result;
+}
+
+// parse_uri_offsets(data) limited to the components of POLICY, for example
+// partial_parse_uri_offsets<uri_parse_policy<uri_component::hostname>>(data)
+template <typename POLICY, typename CHAR_CONTAINER>
+constexpr uri_offsets partial_parse_uri_offsets(
+    std::basic_string_view<CHAR_CONTAINER> data)
+{
+   return parse_uri_offsets<CHAR_CONTAINER, basic_delimiter_scanner, POLICY>(
+       data);
+}
+
+template <typename CHAR_CONTAINER>
+constexpr uri_offsets constexpr_parse_uri_offsets(
+    std::basic_string_view<CHAR_CONTAINER> data)
+{
+   return parse_uri_offsets<CHAR_CONTAINER, basic_constexpr_delimiter_scanner>(
+       data);
+}
+
+// Check the characters of a parsed uri against RFC 3986: a scheme starting
+// with a letter, a numeric port, only printable ascii characters out of
+// " <>\^`{|}" and complete percent escapes
+template <typename CHAR_CONTAINER>
+constexpr bool is_well_formed_uri(
+    std::basic_string_view<CHAR_CONTAINER> data, const uri_offsets& offsets)
+{
+   auto is_alpha = [](CHAR_CONTAINER c) {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+   };
+   auto is_digit = [](CHAR_CONTAINER c) { return c >= '0' && c <= '9'; };
+   auto is_hex = [&](CHAR_CONTAINER c) {
+      return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+   };
+
+   const uri_span scheme = span_of(offsets, uri_component::scheme);
+   if(scheme.length > 0 && !is_alpha(data[0]))
+      return false;
+   for(std::size_t i = 1; i < scheme.length; ++i)
+   {
+      CHAR_CONTAINER c = data[i];
+      if(!is_alpha(c) && !is_digit(c) && c != '+' && c != '-' && c != '.')
+         return false;
+   }
+
+   const uri_span port = span_of(offsets, uri_component::port);
+   for(std::size_t i = port.offset; i < port.offset + port.length; ++i)
+   {
+      if(!is_digit(data[i]))
+         return false;
+   }
+
+   for(std::size_t i = 0; i < data.size(); ++i)
+   {
+      CHAR_CONTAINER c = data[i];
+      if(c <= ' ' || c >= 0x7F || c == '"' || c == '<' || c == '>'
+          || c == '\\' || c == '^' || c == '`' || c == '{' || c == '|'
+          || c == '}')
+         return false;
+      if(c == '%')
+      {
+         if(i + 2 >= data.size() || !is_hex(data[i + 1])
+             || !is_hex(data[i + 2]))
+            return false;
+         i += 2;
+      }
+   }
+   return true;
+}
+
+// 64 bits FNV-1a over the characters of an uri
+class uri_hasher
+{
+   public:
+   template <typename CHAR> void update(CHAR c)
+   {
+      typedef typename std::make_unsigned<CHAR>::type unsigned_type;
+      _value ^= static_cast<std::uint64_t>(static_cast<unsigned_type>(c));
+      _value *= 0x100000001b3ULL;
+   }
+
+   template <typename CHAR> void update(const CHAR* data, std::size_t size)
+   {
+      for(std::size_t i = 0; i < size; ++i)
+         update(data[i]);
+   }
+
+   std::uint64_t value() const { return _value; }
+
+   private:
+   std::uint64_t _value = 0xcbf29ce484222325ULL;
+};
+
+template <typename CHAR_CONTAINER>
+std::uint64_t hash_uri_data(std::basic_string_view<CHAR_CONTAINER> data)
+{
+   uri_hasher hasher;
+   hasher.update(data.data(), data.size());
+   return hasher.value();
+}
+
+// Fold a 64 bits hash for the tables indexed by 32 bits
+inline std::uint32_t fold_hash(std::uint64_t hash)
+{
+   return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+// Port implied by the scheme, 0 when unknown
+template <typename CHAR_CONTAINER>
+std::uint32_t default_port(std::basic_string_view<CHAR_CONTAINER> scheme)
+{
+   auto is = [&scheme](const char* name) {
+      std::size_t i = 0;
+      for(; name[i] != 0; ++i)
+      {
+         if(i == scheme.size() || (scheme[i] | 0x20) != name[i])
+            return false;
+      }
+      return i == scheme.size();
+   };
+   if(is("http") || is("ws"))
+      return 80;
+   if(is("https") || is("wss"))
+      return 443;
+   if(is("ftp"))
+      return 21;
+   return 0;
+}
+
+// Remove the "." and ".." segments of a path as per RFC 3986 5.2.4
+// out can be in itself, the output is never longer than the input
+// Return the size of the output
+template <typename CHAR_CONTAINER>
+std::size_t remove_dot_segments(
+    const CHAR_CONTAINER* in, std::size_t size, CHAR_CONTAINER* out)
+{
+   std::size_t i = 0;
+   std::size_t o = 0;
+   auto starts = [&](const char* prefix) {
+      std::size_t j = 0;
+      for(; prefix[j] != 0; ++j)
+      {
+         if(i + j == size || in[i + j] != prefix[j])
+            return false;
+      }
+      return true;
+   };
+   auto equals = [&](const char* str, std::size_t length) {
+      return size - i == length && starts(str);
+   };
+   auto pop = [&]() {
+      while(o > 0 && out[o - 1] != '/')
+         --o;
+      if(o > 0)
+         --o;
+   };
+
+   while(i < size)
+   {
+      if(starts("../"))
+         i += 3;
+      else if(starts("./"))
+         i += 2;
+      else if(starts("/./"))
+         i += 2;
+      else if(equals("/.", 2))
+      {
+         out[o++] = '/';
+         i = size;
+      }
+      else if(starts("/../"))
+      {
+         i += 3;
+         pop();
+      }
+      else if(equals("/..", 3))
+      {
+         pop();
+         out[o++] = '/';
+         i = size;
+      }
+      else if(equals(".", 1) || equals("..", 2))
+         i = size;
+      else
+      {
+         out[o++] = in[i++];
+         while(i < size && in[i] != '/')
+            out[o++] = in[i++];
+      }
+   }
+   return o;
+}
+
+// Normalize an uri in place as per RFC 3986 6.2.2 and 6.2.3: lowercase the
+// scheme and the host, uppercase the percent escapes, drop the default port
+// and remove the dot segments of the path
+// size and offsets are updated, the hash of the normalized data is computed
+// while writing it
+template <typename CHAR_CONTAINER>
+std::uint64_t normalize_uri_in_place(
+    CHAR_CONTAINER* data, std::size_t& size, uri_offsets& offsets)
+{
+   typedef std::uint32_t pos_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   uri_hasher hasher;
+   pos_type read = 0;
+   pos_type written = 0;
+   auto is_hex = [](CHAR_CONTAINER c) {
+      return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')
+          || (c >= 'A' && c <= 'F');
+   };
+   auto upper = [](CHAR_CONTAINER c) {
+      return c >= 'a' && c <= 'z' ? CHAR_CONTAINER(c - 'a' + 'A') : c;
+   };
+   auto lower = [](CHAR_CONTAINER c) {
+      return c >= 'A' && c <= 'Z' ? CHAR_CONTAINER(c - 'A' + 'a') : c;
+   };
+   auto normalize_escapes = [&](pos_type beg, pos_type end, bool to_lower) {
+      for(pos_type i = beg; i < end; ++i)
+      {
+         if(data[i] == '%' && i + 2 < end && is_hex(data[i + 1])
+             && is_hex(data[i + 2]))
+         {
+            data[i + 1] = upper(data[i + 1]);
+            data[i + 2] = upper(data[i + 2]);
+            i += 2;
+         }
+         else if(to_lower)
+            data[i] = lower(data[i]);
+      }
+   };
+   // move [read, end) to written, hashing it
+   auto copy = [&](pos_type end, bool to_lower) {
+      pos_type beg = written;
+      for(; read < end; ++read, ++written)
+         data[written] = data[read];
+      normalize_escapes(beg, written, to_lower);
+      hasher.update(data + beg, written - beg);
+   };
+
+   const uri_span scheme = span_of(offsets, uri_component::scheme);
+   const uri_span authority = span_of(offsets, uri_component::authority);
+   const uri_span hostname = span_of(offsets, uri_component::hostname);
+   const uri_span port = span_of(offsets, uri_component::port);
+   const uri_span path = span_of(offsets, uri_component::path);
+   const uri_span query = span_of(offsets, uri_component::query);
+   const uri_span fragment = span_of(offsets, uri_component::fragment);
+
+   copy(scheme.length, true);
+
+   const bool has_authority = authority.offset >= 2
+       && data[authority.offset - 1] == '/' && data[authority.offset - 2] == '/';
+   if(has_authority)
+   {
+      copy(hostname.offset, false);
+      copy(hostname.offset + hostname.length, true);
+
+      const pos_type authority_end = authority.offset + authority.length;
+      std::uint32_t port_value = 0;
+      bool numeric = port.length <= 5;
+      for(pos_type i = 0; numeric && i < port.length; ++i)
+      {
+         auto c = data[port.offset + i];
+         numeric = c >= '0' && c <= '9';
+         port_value = port_value * 10 + static_cast<std::uint32_t>(c - '0');
+      }
+      if(read < authority_end
+          && (port.length == 0
+                 || (numeric
+                        && port_value
+                            == default_port(string_view_type(data, scheme.length)))))
+      {
+         read = authority_end;
+         span_of(offsets, uri_component::port) = uri_span{written, 0};
+      }
+      else
+      {
+         span_of(offsets, uri_component::port).offset -= read - written;
+         copy(authority_end, false);
+      }
+      span_of(offsets, uri_component::authority).length
+          = written - authority.offset;
+   }
+
+   copy(path.offset, false);
+   const pos_type path_beg = written;
+   written += static_cast<pos_type>(
+       remove_dot_segments(data + read, path.length, data + written));
+   read = path.offset + path.length;
+   normalize_escapes(path_beg, written, false);
+   hasher.update(data + path_beg, written - path_beg);
+   span_of(offsets, uri_component::path) = uri_span{path_beg, written - path_beg};
+
+   span_of(offsets, uri_component::query).offset = written;
+   copy(query.offset + query.length, false);
+   span_of(offsets, uri_component::fragment).offset = written;
+   copy(fragment.offset + fragment.length, false);
+
+   size = written;
+   return hasher.value();
+}
+
+// Non owning, read only view of an URI | URL | URN, as per defined in RFC 3986
+// The viewed buffer must outlive the view, nothing is ever allocated
+
+template <typename CHAR_CONTAINER> class basic_uri_view
 {
    public:
    typedef std::basic_string<CHAR_CONTAINER> string_type;
@@ -87,6 +779,304 @@ template <typename CHAR_CONTAINER> class basic_uri
    typedef basic_uri_tokenizer<CHAR_CONTAINER, '?'> query_tokenizer;
    typedef basic_uri_tokenizer<CHAR_CONTAINER, '#'> fragment_tokenizer;
 
+   basic_uri_view() = default;
+   basic_uri_view(const basic_uri_view&) = default;
+   basic_uri_view(basic_uri_view&&) = default;
+   basic_uri_view& operator=(const basic_uri_view&) = default;
+   basic_uri_view& operator=(basic_uri_view&&) = default;
+   ~basic_uri_view() = default;
+
+   basic_uri_view(const string_view_type& view)
+       : _data(view), _offsets(parse_uri_offsets(view))
+   {
+   }
+
+   // only the components of the policy are available, the others are empty
+   template <uri_component... COMPONENTS>
+   basic_uri_view(
+       const string_view_type& view, uri_parse_policy<COMPONENTS...>)
+       : _data(view)
+       , _offsets(partial_parse_uri_offsets<uri_parse_policy<COMPONENTS...>>(
+             view))
+   {
+   }
+
+   // offsets must have been computed by parse_uri_offsets on the same data
+   constexpr basic_uri_view(
+       const string_view_type& view, const uri_offsets& offsets)
+       : _data(view), _offsets(offsets)
+   {
+   }
+
+   bool operator==(const basic_uri_view& rhs) const
+   {
+      return _data == rhs._data;
+   }
+
+   bool operator!=(const basic_uri_view& rhs) const
+   {
+      return !operator==(rhs);
+   }
+
+   bool operator>(const basic_uri_view& rhs) const
+   {
+      return _data > rhs._data;
+   }
+
+   bool operator<(const basic_uri_view& rhs) const
+   {
+      return _data < rhs._data;
+   }
+
+   constexpr bool absolute() const
+   {
+      return scheme().size() > 0 && authority().size() > 0;
+   }
+
+   constexpr const string_view_type& data() const { return _data; }
+   constexpr std::size_t size() const { return _data.size(); }
+   constexpr const uri_offsets& offsets() const { return _offsets; }
+
+   constexpr string_view_type component(uri_component c) const
+   {
+      const uri_span& span = span_of(_offsets, c);
+      return _data.substr(span.offset, span.length);
+   }
+
+   constexpr string_view_type scheme() const
+   {
+      return component(uri_component::scheme);
+   }
+
+   constexpr string_view_type authority() const
+   {
+      return component(uri_component::authority);
+   }
+
+   constexpr string_view_type userinfo() const
+   {
+      return component(uri_component::userinfo);
+   }
+
+   constexpr string_view_type user() const
+   {
+      return component(uri_component::user);
+   }
+
+   constexpr string_view_type password() const
+   {
+      return component(uri_component::password);
+   }
+
+   constexpr string_view_type hostname() const
+   {
+      return component(uri_component::hostname);
+   }
+
+   // classified on each call, basic_uri classify once per hostname
+   constexpr uri_host_type host_type() const
+   {
+      return classify_host(hostname());
+   }
+
+   // binary address of an IPv4 host, in network order
+   constexpr convert_status host_address(ipv4_address& address) const
+   {
+      return parse_ipv4(hostname(), address);
+   }
+
+   // binary address of a bracketed IPv6 host, in network order
+   constexpr convert_status host_address(ipv6_address& address) const
+   {
+      string_view_type host = hostname();
+      if(host.size() < 2 || host.front() != '[' || host.back() != ']')
+         return host.empty() ? convert_status::empty
+                             : convert_status::invalid_digit;
+      return parse_ipv6(host.substr(1, host.size() - 2), address);
+   }
+
+   // 0 when the port is absent or malformed
+   constexpr uint32_t port() const
+   {
+      uint32_t value = 0;
+      port(value);
+      return value;
+   }
+
+   // value is only written on success, an absent port is empty
+   constexpr convert_status port(uint32_t& value) const
+   {
+      return parse_uint<uint32_t>(
+          component(uri_component::port), value, 65535);
+   }
+
+   path_tokenizer paths() const
+   {
+      return path_tokenizer(component(uri_component::path));
+   }
+
+   query_tokenizer queries() const
+   {
+      return query_tokenizer(component(uri_component::query));
+   }
+
+   fragment_tokenizer fragments() const
+   {
+      return fragment_tokenizer(component(uri_component::fragment));
+   }
+
+   private:
+   string_view_type _data;
+   uri_offsets _offsets;
+};
+
+// Resolve a reference against a base uri as per RFC 3986 5.2, strict parser
+// The components are taken from the already parsed spans of both views, the
+// paths are merged and their dot segments removed in data itself
+// data is overwritten and must not be viewed by base or reference, its
+// capacity is reused, return the offsets of data
+template <typename CHAR_CONTAINER>
+uri_offsets resolve_uri_to(const basic_uri_view<CHAR_CONTAINER>& base,
+    const basic_uri_view<CHAR_CONTAINER>& reference,
+    std::basic_string<CHAR_CONTAINER>& data)
+{
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef std::uint32_t pos_type;
+
+   auto has_scheme = [](const view_type& u) {
+      return u.size() > u.scheme().size() && u.data()[u.scheme().size()] == ':';
+   };
+   auto has_authority = [](const view_type& u) {
+      const uri_span& authority = span_of(u.offsets(), uri_component::authority);
+      return authority.offset >= 2 && u.data()[authority.offset - 1] == '/'
+          && u.data()[authority.offset - 2] == '/';
+   };
+
+   const string_view_type base_path = base.component(uri_component::path);
+   const string_view_type reference_path
+       = reference.component(uri_component::path);
+   const bool reference_scheme = has_scheme(reference);
+   const bool reference_authority = has_authority(reference);
+   const bool reference_path_only = !reference_scheme && !reference_authority;
+
+   const view_type* scheme_source = reference_scheme
+       ? &reference
+       : (has_scheme(base) ? &base : nullptr);
+   const view_type* authority_source = nullptr;
+   if(!reference_path_only)
+      authority_source = reference_authority ? &reference : nullptr;
+   else if(has_authority(base))
+      authority_source = &base;
+   const bool keep_base_path = reference_path_only && reference_path.empty();
+   const string_view_type query = keep_base_path
+           && reference.component(uri_component::query).empty()
+       ? base.component(uri_component::query)
+       : reference.component(uri_component::query);
+   const string_view_type fragment
+       = reference.component(uri_component::fragment);
+
+   // the path prefix taken from the base when merging
+   const bool merge = reference_path_only && !reference_path.empty()
+       && reference_path.front() != '/';
+   const bool merge_slash
+       = merge && authority_source != nullptr && base_path.empty();
+   string_view_type merge_prefix;
+   if(merge && !merge_slash)
+      merge_prefix = base_path.substr(0, base_path.rfind('/') + 1);
+
+   data.resize((scheme_source ? scheme_source->scheme().size() + 1 : 0)
+       + (authority_source ? authority_source->authority().size() + 2 : 0)
+       + (keep_base_path ? base_path.size()
+                         : merge_prefix.size() + merge_slash
+                   + reference_path.size())
+       + query.size() + fragment.size());
+
+   uri_offsets offsets;
+   CHAR_CONTAINER* out = &data[0];
+   pos_type pos = 0;
+   auto write = [&](const string_view_type& str) {
+      std::copy(str.begin(), str.end(), out + pos);
+      pos += static_cast<pos_type>(str.size());
+   };
+
+   if(scheme_source)
+   {
+      write(scheme_source->scheme());
+      span_of(offsets, uri_component::scheme)
+          = uri_span{0, static_cast<pos_type>(scheme_source->scheme().size())};
+      out[pos++] = ':';
+   }
+
+   if(authority_source)
+   {
+      out[pos++] = '/';
+      out[pos++] = '/';
+      const uri_offsets& source = authority_source->offsets();
+      const pos_type source_beg
+          = span_of(source, uri_component::authority).offset;
+      for(std::size_t c = static_cast<std::size_t>(uri_component::authority);
+          c <= static_cast<std::size_t>(uri_component::port); ++c)
+         offsets[c] = uri_span{
+             source[c].offset - source_beg + pos, source[c].length};
+      write(authority_source->authority());
+   }
+
+   const pos_type path_beg = pos;
+   if(keep_base_path)
+      write(base_path);
+   else
+   {
+      write(merge_prefix);
+      if(merge_slash)
+         out[pos++] = '/';
+      write(reference_path);
+      pos = path_beg
+          + static_cast<pos_type>(remove_dot_segments(
+              out + path_beg, pos - path_beg, out + path_beg));
+   }
+   span_of(offsets, uri_component::path) = uri_span{path_beg, pos - path_beg};
+
+   span_of(offsets, uri_component::query)
+       = uri_span{pos, static_cast<pos_type>(query.size())};
+   write(query);
+   span_of(offsets, uri_component::fragment)
+       = uri_span{pos, static_cast<pos_type>(fragment.size())};
+   write(fragment);
+
+   data.resize(pos);
+   return offsets;
+}
+
+// Parse an uri known at compile time, the offsets are computed by the
+// compiler when the result is constexpr
+// A malformed uri doesn't compile in a constant expression, and throws
+// std::invalid_argument at runtime
+template <typename CHAR_CONTAINER>
+constexpr basic_uri_view<CHAR_CONTAINER> make_static_uri_view(
+    std::basic_string_view<CHAR_CONTAINER> data)
+{
+   const uri_offsets offsets = constexpr_parse_uri_offsets(data);
+   if(!is_well_formed_uri(data, offsets))
+      throw std::invalid_argument("malformed uri");
+   return basic_uri_view<CHAR_CONTAINER>(data, offsets);
+}
+
+// Read only implementation of URI | URL | URN, as per defined in RFC 3986
+// Own a copy of its data, the components are located and the data hashed
+// once at construction, every accessor go through view()
+// Two uris are equal when their data are, the hashes are compared first
+
+template <typename CHAR_CONTAINER> class basic_uri
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+   typedef typename view_type::path_tokenizer path_tokenizer;
+   typedef typename view_type::query_tokenizer query_tokenizer;
+   typedef typename view_type::fragment_tokenizer fragment_tokenizer;
+
    basic_uri() = default;
    basic_uri(const basic_uri&) = default;
    basic_uri(basic_uri&&) = default;
@@ -96,11 +1086,10 @@ template <typename CHAR_CONTAINER> class basic_uri
 
    bool operator==(const basic_uri& rhs) const
    {
-      return scheme() == rhs.scheme() && authority() == rhs.authority()
-          && userinfo() == rhs.userinfo() && user() == rhs.user()
-          && password() == rhs.password() && hostname() == rhs.hostname()
-          && port() == rhs.port() && paths() == rhs.paths()
-          && queries() == rhs.queries() && fragments() == rhs.fragments();
+      return _hash == rhs._hash && _data.size() == rhs._data.size()
+          && std::char_traits<CHAR_CONTAINER>::compare(
+                 _data.data(), rhs._data.data(), _data.size())
+          == 0;
    }
 
    bool operator!=(const basic_uri& rhs) const { return !operator==(rhs); }
@@ -111,168 +1100,413 @@ template <typename CHAR_CONTAINER> class basic_uri
 
    basic_uri(const string_view_type& view)
        : _data(view)
+       , _offsets(parse_uri_offsets(string_view_type(_data)))
+       , _hash(hash_uri_data(string_view_type(_data)))
+       , _host_type(classify_host(this->view().hostname()))
    {
    }
 
    basic_uri(string_type&& str)
-       : _data(str)
+       : _data(std::move(str))
+       , _offsets(parse_uri_offsets(string_view_type(_data)))
+       , _hash(hash_uri_data(string_view_type(_data)))
+       , _host_type(classify_host(this->view().hostname()))
    {
    }
 
-   bool absolute() const
+   // offsets must have been computed by parse_uri_offsets on the same data
+   basic_uri(string_type&& str, const uri_offsets& offsets)
+       : _data(std::move(str))
+       , _offsets(offsets)
+       , _hash(hash_uri_data(string_view_type(_data)))
+       , _host_type(classify_host(this->view().hostname()))
    {
-      return scheme().size() > 0 && authority().size() > 0;
    }
 
+   // copy the viewed data, the already computed offsets are kept
+   explicit basic_uri(const view_type& view)
+       : _data(view.data())
+       , _offsets(view.offsets())
+       , _hash(hash_uri_data(view.data()))
+       , _host_type(view.host_type())
+   {
+   }
+
+   view_type view() const { return view_type(_data, _offsets); }
+   operator view_type() const { return view(); }
+
+   bool absolute() const { return view().absolute(); }
+
    const string_type& data() const { return _data; }
    const std::size_t size() const { return _data.size(); }
+   const uri_offsets& offsets() const { return _offsets; }
+   // hash_uri_data of the data, computed at construction
+   std::uint64_t hash() const { return _hash; }
+   // classify_host of the hostname, computed with it
+   uri_host_type host_type() const { return _host_type; }
 
-   string_view_type scheme() const
+   string_view_type component(uri_component c) const
    {
-      auto pos = _data.find_first_of(':');
-      if(pos != string_type::npos)
-         return string_view_type(_data.c_str(), pos);
-      return {};
+      return view().component(c);
    }
 
-   string_view_type authority() const
+   string_view_type scheme() const { return view().scheme(); }
+   string_view_type authority() const { return view().authority(); }
+   string_view_type userinfo() const { return view().userinfo(); }
+   string_view_type user() const { return view().user(); }
+   string_view_type password() const { return view().password(); }
+   string_view_type hostname() const { return view().hostname(); }
+   uint32_t port() const { return view().port(); }
+   convert_status port(uint32_t& value) const { return view().port(value); }
+   convert_status host_address(ipv4_address& address) const
    {
-      std::size_t start = _data.find("//");
-      if(start != string_type::npos)
-      {
-         start += 2;
-
-         std::size_t end = (std::min)(
-             _data.find_first_of('/', start), _data.find_first_of('?', start));
-         end = (std::min)(end, _data.find_first_of('#', start));
-         if(end != string_type::npos)
-            return {_data.c_str() + start, end - start};
-         return {_data.c_str() + start};
-      }
-      return {};
+      return view().host_address(address);
    }
-
-   string_view_type userinfo() const
+   convert_status host_address(ipv6_address& address) const
    {
-      auto autho = authority();
-      std::size_t pos = autho.find_first_of('@');
-      if(pos != string_type::npos)
-      {
-         return autho.substr(0, pos);
-      }
-      return {};
+      return view().host_address(address);
    }
+   path_tokenizer paths() const { return view().paths(); }
+   query_tokenizer queries() const { return view().queries(); }
+   fragment_tokenizer fragments() const { return view().fragments(); }
 
-   string_view_type user() const
+   // Resolve a reference against this uri, see resolve_uri_to
+   basic_uri resolve(const view_type& reference) const
    {
-      auto unp = userinfo();
-      auto pos = unp.find_first_of(':');
-      return unp.substr(0, pos);
+      string_type data;
+      uri_offsets offsets = resolve_uri_to(view(), reference, data);
+      return basic_uri(std::move(data), offsets);
    }
 
-   string_view_type password() const
+   // Normalize the uri as per RFC 3986 section 6, see normalize_uri_in_place
+   // The data is rewritten without reallocation, return its new hash
+   std::uint64_t normalize()
    {
-      auto unp = userinfo();
-      auto pos = unp.find_first_of(':');
-      if(pos != string_view_type::npos)
-         return unp.substr(pos + DELIMITOR_SIZE);
-      return {};
+      std::size_t size = _data.size();
+      _hash = normalize_uri_in_place(&_data[0], size, _offsets);
+      _data.resize(size);
+      _host_type = classify_host(view().hostname());
+      return _hash;
    }
 
-   string_view_type hostname() const
+   // The following setters splice the new characters into the data and
+   // shift the offsets of the following components, nothing is reparsed
+   // The values are written as is, they must already be percent encoded
+
+   // host must be a valid host, IP literals with their brackets
+   // An uri without authority get one, and is parsed again
+   void set_hostname(const string_view_type& host)
    {
-      auto autho = authority();
-      auto user_info_pos = userinfo().size();
-      if(user_info_pos > 0)
-         user_info_pos += DELIMITOR_SIZE;
-      auto host_port = autho.substr(user_info_pos);
-      auto end = host_port.find_first_of(':');
-      return host_port.substr(0, end);
+      const uri_span& authority = span_of(_offsets, uri_component::authority);
+      if(authority.offset < 2)
+      {
+         const uri_span& scheme = span_of(_offsets, uri_component::scheme);
+         const std::size_t pos = scheme.length != 0 ? scheme.length + 1 : 0;
+         const uri_span& path = span_of(_offsets, uri_component::path);
+         if(path.length != 0 && _data[path.offset] != '/')
+            _data.insert(path.offset, 1, '/');
+         const CHAR_CONTAINER slashes[] = {'/', '/'};
+         _data.insert(pos, slashes, 2);
+         _data.insert(pos + 2, host.data(), host.size());
+         _offsets = parse_uri_offsets(string_view_type(_data));
+         _hash = hash_uri_data(string_view_type(_data));
+         _host_type = classify_host(view().hostname());
+         return;
+      }
+
+      const uri_span hostname = span_of(_offsets, uri_component::hostname);
+      splice(uri_component::hostname, hostname.offset, hostname.length, host,
+          uri_span{hostname.offset, static_cast<std::uint32_t>(host.size())});
    }
 
-   uint32_t port() const
+   // port must be decimal digits, an empty port remove the ':' as well
+   // An uri without authority is left unchanged
+   void set_port(const string_view_type& port)
    {
-      auto autho = authority();
-      auto user_info_pos = userinfo().size();
-      if(user_info_pos > 0)
-         user_info_pos += DELIMITOR_SIZE;
-      auto host_port = autho.substr(user_info_pos);
-      auto delimitor = host_port.find_first_of(':');
-      if(delimitor != string_view_type::npos)
+      const uri_span& authority = span_of(_offsets, uri_component::authority);
+      if(authority.offset < 2)
+         return;
+      const uri_span current = span_of(_offsets, uri_component::port);
+      const uri_span& hostname = span_of(_offsets, uri_component::hostname);
+      const bool colon
+          = current.offset == hostname.offset + hostname.length + 1;
+      if(port.empty())
       {
-         auto port = host_port.substr(delimitor + 1);
-         if(port.size())
-         {
-            return std::stoul(std::string(port));
-         }
+         if(colon)
+            splice(uri_component::port, current.offset - 1, current.length + 1,
+                port, uri_span{current.offset - 1, 0});
+         return;
+      }
+      if(colon)
+         splice(uri_component::port, current.offset, current.length, port,
+             uri_span{current.offset, static_cast<std::uint32_t>(port.size())});
+      else
+      {
+         string_type text(1, ':');
+         text.append(port.data(), port.size());
+         splice(uri_component::port, current.offset, 0, text,
+             uri_span{current.offset + 1, static_cast<std::uint32_t>(port.size())});
       }
-      return {};
    }
 
-   path_tokenizer paths() const
+   void set_port(std::uint32_t port)
+   {
+      CHAR_CONTAINER digits[10];
+      std::size_t count = 0;
+      do
+      {
+         digits[sizeof(digits) / sizeof(digits[0]) - ++count]
+             = static_cast<CHAR_CONTAINER>('0' + port % 10);
+         port /= 10;
+      } while(port != 0);
+      set_port(string_view_type(
+          digits + sizeof(digits) / sizeof(digits[0]) - count, count));
+   }
+
+   // with an authority the path must be empty or start with '/'
+   void set_path(const string_view_type& path)
    {
-      auto scheme_size = scheme().size();
-      auto authority_size = authority().size();
-      std::size_t start = 0;
-      if(authority_size > 0)
-         start = _data.find_first_of('/', scheme_size + authority_size);
-      else if(scheme_size > 0)
-         start = scheme_size + DELIMITOR_SIZE;
+      const uri_span current = span_of(_offsets, uri_component::path);
+      splice(uri_component::path, current.offset, current.length, path,
+          uri_span{current.offset, static_cast<std::uint32_t>(path.size())});
+   }
 
-      if(start != string_type::npos)
+   // Replace the value of the first parameter named key, or append key=value
+   // to the query, the other parameters are untouched
+   void set_query_param(
+       const string_view_type& key, const string_view_type& value)
+   {
+      const uri_span query = span_of(_offsets, uri_component::query);
+      const std::size_t end = query.offset + query.length;
+      const string_view_type data(_data);
+      const CHAR_CONTAINER* found_key = nullptr;
+      string_view_type found_value;
+      for_each_query_pair(data.substr(query.offset, query.length),
+          [&](const string_view_type& k, const string_view_type& v) {
+             if(found_key == nullptr && k == key)
+             {
+                found_key = k.data();
+                found_value = v;
+             }
+          });
+      if(found_key != nullptr)
       {
-         auto end = (std::min)(
-             _data.find_first_of('?', start), _data.find_first_of('#', start));
-         if(end != string_type::npos)
+         const std::size_t key_end = found_key - data.data() + key.size();
+         const std::size_t value_pos = found_value.data() - data.data();
+         if(value_pos == key_end)
          {
-            return path_tokenizer(
-                string_view_type{_data.c_str() + start, end - start});
+            string_type text(1, '=');
+            text.append(value.data(), value.size());
+            splice_query(key_end, 0, text);
          }
          else
-         {
-            return {_data.c_str() + start};
-         }
+            splice_query(value_pos, found_value.size(), value);
+         return;
       }
-      return {};
+
+      string_type text;
+      text.reserve(key.size() + value.size() + 2);
+      if(query.length == 0)
+         text += '?';
+      else if(query.length > 1 && _data[end - 1] != '&')
+         text += '&';
+      text.append(key.data(), key.size());
+      text += '=';
+      text.append(value.data(), value.size());
+      splice_query(end, 0, text);
    }
 
-   query_tokenizer queries() const
+   private:
+   static bool contains(uri_component outer, uri_component inner)
    {
-      auto start = _data.find_first_of('?');
-      auto end = _data.find_first_of('#');
-      if(start != string_type::npos)
-      {
-         if(end != string_type::npos)
-         {
-            return string_view_type{_data.c_str() + start, end - start};
-         }
-         return {_data.c_str() + start};
-      }
-      return {};
+      if(outer == uri_component::authority)
+         return inner >= uri_component::userinfo
+             && inner <= uri_component::port;
+      if(outer == uri_component::userinfo)
+         return inner == uri_component::user
+             || inner == uri_component::password;
+      return false;
    }
 
-   fragment_tokenizer fragments() const
+   // replace count characters at pos by text, the span of c become result
+   // the components containing c grow, the ones after c move
+   void splice(uri_component c, std::size_t pos, std::size_t count,
+       const string_view_type& text, const uri_span& result)
    {
-      auto start = _data.find_first_of('#');
-      if(start != string_type::npos)
+      _data.replace(pos, count, text.data(), text.size());
+      const std::uint32_t delta
+          = static_cast<std::uint32_t>(text.size() - count);
+      for(std::size_t i = 0; i < _offsets.size(); ++i)
       {
-         return string_view_type{_data.c_str() + start};
+         const uri_component other = static_cast<uri_component>(i);
+         if(other == c || contains(c, other))
+            continue;
+         if(contains(other, c))
+            _offsets[i].length += delta;
+         else if(other > c)
+            _offsets[i].offset += delta;
       }
-      return {};
+      span_of(_offsets, c) = result;
+      _hash = hash_uri_data(string_view_type(_data));
+      if(c == uri_component::hostname)
+         _host_type = classify_host(view().hostname());
+   }
+
+   void splice_query(std::size_t pos, std::size_t count, const string_view_type& text)
+   {
+      uri_span query = span_of(_offsets, uri_component::query);
+      query.length += static_cast<std::uint32_t>(text.size() - count);
+      splice(uri_component::query, pos, count, text, query);
    }
 
-   private:
    string_type _data;
+   uri_offsets _offsets;
+   std::uint64_t _hash = uri_hasher().value();
+   uri_host_type _host_type = uri_host_type::none;
+};
 
-   enum
+template <typename CHAR_CONTAINER>
+basic_uri<CHAR_CONTAINER> resolve(const basic_uri_view<CHAR_CONTAINER>& base,
+    const basic_uri_view<CHAR_CONTAINER>& reference)
+{
+   std::basic_string<CHAR_CONTAINER> data;
+   uri_offsets offsets = resolve_uri_to(base, reference, data);
+   return basic_uri<CHAR_CONTAINER>(std::move(data), offsets);
+}
+
+// Order by hostname, then path, then whole data
+// To sort many uris, sort_by_host_path compute the keys once
+struct uri_host_path_less
+{
+   template <typename CHAR_CONTAINER>
+   bool operator()(const basic_uri_view<CHAR_CONTAINER>& lhs,
+       const basic_uri_view<CHAR_CONTAINER>& rhs) const
    {
-      SCHEME_DELIMITOR_SIZE = 3,
-      DELIMITOR_SIZE = 1,
-   };
+      if(int c = lhs.hostname().compare(rhs.hostname()))
+         return c < 0;
+      if(int c = lhs.component(uri_component::path).compare(
+             rhs.component(uri_component::path)))
+         return c < 0;
+      return lhs.data() < rhs.data();
+   }
+
+   template <typename CHAR_CONTAINER>
+   bool operator()(const basic_uri<CHAR_CONTAINER>& lhs,
+       const basic_uri<CHAR_CONTAINER>& rhs) const
+   {
+      return operator()(lhs.view(), rhs.view());
+   }
 };
 
+// Key of uri_host_path_less, computed once per uri
+// The first characters of the hostname and of the path are packed in
+// integers compared first, the strings are only compared on a tie
+// It refers to the uri data, which must outlive it
+template <typename CHAR_CONTAINER> class basic_uri_host_path_key
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   explicit basic_uri_host_path_key(const basic_uri_view<CHAR_CONTAINER>& uri)
+       : _host(uri.hostname())
+       , _path(uri.component(uri_component::path))
+       , _data(uri.data())
+       , _host_prefix(prefix_of(_host))
+       , _path_prefix(prefix_of(_path))
+   {
+   }
+
+   explicit basic_uri_host_path_key(const basic_uri<CHAR_CONTAINER>& uri)
+       : basic_uri_host_path_key(uri.view())
+   {
+   }
+
+   bool operator<(const basic_uri_host_path_key& rhs) const
+   {
+      if(_host_prefix != rhs._host_prefix)
+         return _host_prefix < rhs._host_prefix;
+      if(int c = _host.compare(rhs._host))
+         return c < 0;
+      if(_path_prefix != rhs._path_prefix)
+         return _path_prefix < rhs._path_prefix;
+      if(int c = _path.compare(rhs._path))
+         return c < 0;
+      return _data < rhs._data;
+   }
+
+   private:
+   // characters above the width of a slot saturate it, the strings then
+   // decide
+   static std::uint64_t prefix_of(const string_view_type& str)
+   {
+      typedef typename std::make_unsigned<CHAR_CONTAINER>::type unsigned_type;
+      const std::size_t width = sizeof(CHAR_CONTAINER) == 1 ? 8 : 4;
+      const unsigned bits = 64 / width;
+      std::uint64_t key = 0;
+      for(std::size_t i = 0; i < width; ++i)
+      {
+         std::uint64_t c = i < str.size()
+             ? static_cast<std::uint64_t>(static_cast<unsigned_type>(str[i]))
+             : 0;
+         if(bits < 64 && c >= (std::uint64_t(1) << bits))
+            c = (std::uint64_t(1) << bits) - 1;
+         key = (key << bits) | c;
+      }
+      return key;
+   }
+
+   string_view_type _host;
+   string_view_type _path;
+   string_view_type _data;
+   std::uint64_t _host_prefix;
+   std::uint64_t _path_prefix;
+};
+
+// Sort [first, last) of uris or views by uri_host_path_less, stable
+// The keys are computed once, sorted with the indices, then each uri is
+// moved once
+template <typename RANDOM_IT> void sort_by_host_path(RANDOM_IT first, RANDOM_IT last)
+{
+   typedef typename std::iterator_traits<RANDOM_IT>::value_type value_type;
+   typedef typename value_type::string_view_type::value_type char_type;
+   typedef std::pair<basic_uri_host_path_key<char_type>, std::size_t> keyed;
+
+   std::vector<keyed> keys;
+   keys.reserve(static_cast<std::size_t>(std::distance(first, last)));
+   for(RANDOM_IT it = first; it != last; ++it)
+      keys.emplace_back(basic_uri_host_path_key<char_type>(*it), keys.size());
+   std::sort(keys.begin(), keys.end(), [](const keyed& lhs, const keyed& rhs) {
+      if(lhs.first < rhs.first)
+         return true;
+      if(rhs.first < lhs.first)
+         return false;
+      return lhs.second < rhs.second;
+   });
+
+   std::vector<value_type> sorted;
+   sorted.reserve(keys.size());
+   for(const keyed& k : keys)
+      sorted.push_back(std::move(first[k.second]));
+   std::move(sorted.begin(), sorted.end(), first);
+}
+
 typedef basic_uri<char> uri;
 typedef basic_uri<wchar_t> wuri;
+typedef basic_uri_view<char> uri_view;
+typedef basic_uri_view<wchar_t> wuri_view;
+
+namespace literals
+{
+// constexpr auto health = "http://localhost:8080/health"_uri;
+constexpr uri_view operator""_uri(const char* data, std::size_t size)
+{
+   return make_static_uri_view(std::string_view(data, size));
+}
+
+constexpr wuri_view operator""_uri(const wchar_t* data, std::size_t size)
+{
+   return make_static_uri_view(std::wstring_view(data, size));
+}
 }
 
 template <typename CHAR>
@@ -283,6 +1517,14 @@ std::basic_ostream<CHAR>& operator<<(
    return stream;
 }
 
+template <typename CHAR>
+std::basic_ostream<CHAR>& operator<<(
+    std::basic_ostream<CHAR>& stream, const xts::basic_uri_view<CHAR>& uri)
+{
+   stream << uri.data();
+   return stream;
+}
+
 template <typename CHAR, CHAR DELIMITOR>
 std::basic_ostream<CHAR>& operator<<(std::basic_ostream<CHAR>& stream,
     const xts::basic_uri_tokenizer<CHAR, DELIMITOR>& token)
@@ -290,5 +1532,26 @@ std::basic_ostream<CHAR>& operator<<(std::basic_ostream<CHAR>& stream,
    stream << token.data();
    return stream;
 }
+}
+
+namespace std
+{
+template <typename CHAR_CONTAINER> struct hash<xts::basic_uri<CHAR_CONTAINER>>
+{
+   std::size_t operator()(const xts::basic_uri<CHAR_CONTAINER>& uri) const
+   {
+      return static_cast<std::size_t>(uri.hash());
+   }
+};
+
+template <typename CHAR_CONTAINER>
+struct hash<xts::basic_uri_view<CHAR_CONTAINER>>
+{
+   std::size_t operator()(const xts::basic_uri_view<CHAR_CONTAINER>& uri) const
+   {
+      return static_cast<std::size_t>(xts::hash_uri_data(uri.data()));
+   }
+};
+}
 
 #endif // !URL_HPP
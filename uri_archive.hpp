@@ -0,0 +1,357 @@
+#ifndef URI_ARCHIVE_HPP
+#define URI_ARCHIVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "uri.hpp"
+
+namespace xts
+{
+// Layout of an uri archive, every section is 8 bytes aligned
+//  - the header
+//  - count + 1 uint64_t, where each uri starts in the data, the last one
+//    being the size of the data
+//  - count uri_offsets, relative to the start of each uri
+//  - the data of every uri, back to back
+// The values are in the byte order of the writer, endian tells it
+struct uri_archive_header
+{
+   char magic[8];
+   std::uint32_t version;
+   std::uint32_t endian;
+   std::uint32_t char_size;
+   std::uint32_t offsets_size;
+   std::uint64_t count;
+   std::uint64_t starts_pos;
+   std::uint64_t offsets_pos;
+   std::uint64_t data_pos;
+   std::uint64_t data_size;
+};
+
+static_assert(sizeof(uri_archive_header) == 64, "packed uri archive header");
+static_assert(std::is_trivially_copyable<uri_offsets>::value
+        && sizeof(uri_offsets) % 8 == 0,
+    "uri_offsets are written as is");
+
+enum : std::uint32_t
+{
+   URI_ARCHIVE_VERSION = 1,
+   URI_ARCHIVE_ENDIAN = 0x01020304
+};
+
+constexpr char uri_archive_magic[8] = {'x', 't', 's', 'u', 'r', 'i', 'a', 0};
+
+// Accumulate uris with their already computed offsets, then write them as
+// one archive
+template <typename CHAR_CONTAINER> class basic_uri_archive_writer
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+
+   void push_back(const view_type& uri)
+   {
+      _starts.push_back(_data.size());
+      _offsets.push_back(uri.offsets());
+      _data.append(uri.data());
+   }
+
+   std::size_t size() const { return _offsets.size(); }
+
+   void clear()
+   {
+      _starts.clear();
+      _offsets.clear();
+      _data.clear();
+   }
+
+   std::size_t serialized_size() const
+   {
+      return data_pos() + padded(_data.size() * sizeof(CHAR_CONTAINER));
+   }
+
+   // buffer hold serialized_size() bytes
+   void write(char* buffer) const
+   {
+      std::memset(buffer, 0, serialized_size());
+      const uri_archive_header h = header();
+      std::memcpy(buffer, &h, sizeof(h));
+      std::memcpy(buffer + h.starts_pos, _starts.data(),
+          _starts.size() * sizeof(std::uint64_t));
+      const std::uint64_t end = _data.size();
+      std::memcpy(buffer + h.starts_pos + _starts.size() * sizeof(std::uint64_t),
+          &end, sizeof(end));
+      std::memcpy(buffer + h.offsets_pos, _offsets.data(),
+          _offsets.size() * sizeof(uri_offsets));
+      std::memcpy(buffer + h.data_pos, _data.data(),
+          _data.size() * sizeof(CHAR_CONTAINER));
+   }
+
+   void write(std::ostream& stream) const
+   {
+      const uri_archive_header h = header();
+      const std::uint64_t end = _data.size();
+      const char padding[8] = {};
+      const std::size_t data_bytes = _data.size() * sizeof(CHAR_CONTAINER);
+
+      stream.write(reinterpret_cast<const char*>(&h), sizeof(h));
+      stream.write(reinterpret_cast<const char*>(_starts.data()),
+          _starts.size() * sizeof(std::uint64_t));
+      stream.write(reinterpret_cast<const char*>(&end), sizeof(end));
+      stream.write(reinterpret_cast<const char*>(_offsets.data()),
+          _offsets.size() * sizeof(uri_offsets));
+      stream.write(reinterpret_cast<const char*>(_data.data()), data_bytes);
+      stream.write(padding, padded(data_bytes) - data_bytes);
+   }
+
+   private:
+   static std::size_t padded(std::size_t size) { return (size + 7) & ~std::size_t(7); }
+
+   std::size_t starts_pos() const { return sizeof(uri_archive_header); }
+
+   std::size_t offsets_pos() const
+   {
+      return starts_pos() + (_starts.size() + 1) * sizeof(std::uint64_t);
+   }
+
+   std::size_t data_pos() const
+   {
+      return offsets_pos() + _offsets.size() * sizeof(uri_offsets);
+   }
+
+   uri_archive_header header() const
+   {
+      uri_archive_header result = {};
+      std::memcpy(result.magic, uri_archive_magic, sizeof(result.magic));
+      result.version = URI_ARCHIVE_VERSION;
+      result.endian = URI_ARCHIVE_ENDIAN;
+      result.char_size = sizeof(CHAR_CONTAINER);
+      result.offsets_size = sizeof(uri_offsets);
+      result.count = _offsets.size();
+      result.starts_pos = starts_pos();
+      result.offsets_pos = offsets_pos();
+      result.data_pos = data_pos();
+      result.data_size = _data.size();
+      return result;
+   }
+
+   std::vector<std::uint64_t> _starts;
+   std::vector<uri_offsets> _offsets;
+   string_type _data;
+};
+
+// Read only access to an archive in memory, typically a mapped file
+// Only the header is checked at construction, nothing is parsed nor copied,
+// each uri is handed out as a basic_uri_view on the archive memory and its
+// bounds checked when it is read, validate() check them all upfront
+// The memory must be 8 bytes aligned and outlive the archive
+template <typename CHAR_CONTAINER> class basic_uri_archive
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+
+   class const_iterator
+   {
+      public:
+      typedef std::random_access_iterator_tag iterator_category;
+      typedef view_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const view_type* pointer;
+      typedef view_type reference;
+
+      const_iterator() = default;
+      const_iterator(const basic_uri_archive* archive, std::size_t index)
+          : _archive(archive), _index(index)
+      {
+      }
+
+      view_type operator*() const { return (*_archive)[_index]; }
+      view_type operator[](difference_type n) const
+      {
+         return (*_archive)[_index + n];
+      }
+
+      const_iterator& operator++()
+      {
+         ++_index;
+         return *this;
+      }
+      const_iterator operator++(int)
+      {
+         const_iterator result = *this;
+         ++_index;
+         return result;
+      }
+      const_iterator& operator--()
+      {
+         --_index;
+         return *this;
+      }
+      const_iterator operator--(int)
+      {
+         const_iterator result = *this;
+         --_index;
+         return result;
+      }
+      const_iterator& operator+=(difference_type n)
+      {
+         _index += n;
+         return *this;
+      }
+      const_iterator& operator-=(difference_type n)
+      {
+         _index -= n;
+         return *this;
+      }
+      const_iterator operator+(difference_type n) const
+      {
+         return const_iterator(_archive, _index + n);
+      }
+      const_iterator operator-(difference_type n) const
+      {
+         return const_iterator(_archive, _index - n);
+      }
+      difference_type operator-(const const_iterator& rhs) const
+      {
+         return static_cast<difference_type>(_index)
+             - static_cast<difference_type>(rhs._index);
+      }
+
+      bool operator==(const const_iterator& rhs) const
+      {
+         return _index == rhs._index;
+      }
+      bool operator!=(const const_iterator& rhs) const
+      {
+         return _index != rhs._index;
+      }
+      bool operator<(const const_iterator& rhs) const
+      {
+         return _index < rhs._index;
+      }
+
+      private:
+      const basic_uri_archive* _archive = nullptr;
+      std::size_t _index = 0;
+   };
+
+   basic_uri_archive() = default;
+   basic_uri_archive(const basic_uri_archive&) = default;
+   basic_uri_archive& operator=(const basic_uri_archive&) = default;
+
+   // an invalid archive is empty
+   basic_uri_archive(const void* memory, std::size_t size)
+   {
+      const char* bytes = static_cast<const char*>(memory);
+      uri_archive_header h;
+      if(size < sizeof(h))
+         return;
+      std::memcpy(&h, bytes, sizeof(h));
+      if(std::memcmp(h.magic, uri_archive_magic, sizeof(h.magic)) != 0
+          || h.version != URI_ARCHIVE_VERSION
+          || h.endian != URI_ARCHIVE_ENDIAN
+          || h.char_size != sizeof(CHAR_CONTAINER)
+          || h.offsets_size != sizeof(uri_offsets))
+         return;
+
+      // each section follow the previous one and end inside the memory,
+      // written so that nothing can overflow
+      const std::uint64_t total = size;
+      if(h.starts_pos % 8 != 0 || h.offsets_pos % 8 != 0 || h.data_pos % 8 != 0
+          || h.starts_pos < sizeof(h) || h.starts_pos > total
+          || (total - h.starts_pos) / sizeof(std::uint64_t) == 0
+          || h.count > (total - h.starts_pos) / sizeof(std::uint64_t) - 1
+          || h.offsets_pos < h.starts_pos + (h.count + 1) * sizeof(std::uint64_t)
+          || h.offsets_pos > total
+          || h.count > (total - h.offsets_pos) / sizeof(uri_offsets)
+          || h.data_pos < h.offsets_pos + h.count * sizeof(uri_offsets)
+          || h.data_pos > total
+          || h.data_size > (total - h.data_pos) / sizeof(CHAR_CONTAINER))
+         return;
+
+      std::uint64_t end = 0;
+      std::memcpy(&end, bytes + h.starts_pos + h.count * sizeof(std::uint64_t),
+          sizeof(end));
+      if(end != h.data_size)
+         return;
+
+      _starts = bytes + h.starts_pos;
+      _offsets = bytes + h.offsets_pos;
+      _data = reinterpret_cast<const CHAR_CONTAINER*>(bytes + h.data_pos);
+      _data_size = h.data_size;
+      _count = static_cast<std::size_t>(h.count);
+      _valid = true;
+   }
+
+   bool valid() const { return _valid; }
+   std::size_t size() const { return _count; }
+   bool empty() const { return _count == 0; }
+
+   // check every uri as operator[] does, in one pass over the tables
+   bool validate() const
+   {
+      for(std::size_t i = 0; i < _count; ++i)
+      {
+         std::uint64_t bounds[2];
+         uri_offsets offsets;
+         if(!read(i, bounds, offsets))
+            return false;
+      }
+      return true;
+   }
+
+   // An uri whose start or offsets are out of its bounds is returned empty,
+   // a corrupted archive never lead to a read out of the memory
+   view_type operator[](std::size_t i) const
+   {
+      std::uint64_t bounds[2];
+      uri_offsets offsets;
+      if(!read(i, bounds, offsets))
+         return view_type();
+      return view_type(string_view_type(_data + bounds[0],
+                           static_cast<std::size_t>(bounds[1] - bounds[0])),
+          offsets);
+   }
+
+   const_iterator begin() const { return const_iterator(this, 0); }
+   const_iterator end() const { return const_iterator(this, _count); }
+
+   private:
+   bool read(std::size_t i, std::uint64_t (&bounds)[2], uri_offsets& offsets) const
+   {
+      std::memcpy(bounds, _starts + i * sizeof(std::uint64_t), sizeof(bounds));
+      if(bounds[0] > bounds[1] || bounds[1] > _data_size)
+         return false;
+      std::memcpy(&offsets, _offsets + i * sizeof(uri_offsets), sizeof(offsets));
+      const std::uint64_t length = bounds[1] - bounds[0];
+      for(const uri_span& span : offsets)
+      {
+         if(span.offset > length || span.length > length - span.offset)
+            return false;
+      }
+      return true;
+   }
+
+   const char* _starts = nullptr;
+   const char* _offsets = nullptr;
+   const CHAR_CONTAINER* _data = nullptr;
+   std::uint64_t _data_size = 0;
+   std::size_t _count = 0;
+   bool _valid = false;
+};
+
+typedef basic_uri_archive_writer<char> uri_archive_writer;
+typedef basic_uri_archive_writer<wchar_t> wuri_archive_writer;
+typedef basic_uri_archive<char> uri_archive;
+typedef basic_uri_archive<wchar_t> wuri_archive;
+}
+
+#endif //!URI_ARCHIVE_HPP
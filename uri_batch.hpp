@@ -0,0 +1,133 @@
+#ifndef URI_BATCH_HPP
+#define URI_BATCH_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "uri.hpp"
+
+namespace xts
+{
+// Parse a buffer of separated uris into a structure of arrays, one array of
+// offsets and one array of lengths per component
+// No object is created per uri, parse() reuse the capacity of the previous
+// call and the buffer must outlive the batch
+template <typename CHAR_CONTAINER> class basic_uri_batch
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+   typedef std::vector<std::uint32_t> column_type;
+
+   basic_uri_batch() = default;
+   basic_uri_batch(const basic_uri_batch&) = default;
+   basic_uri_batch(basic_uri_batch&&) = default;
+   basic_uri_batch& operator=(const basic_uri_batch&) = default;
+   basic_uri_batch& operator=(basic_uri_batch&&) = default;
+   ~basic_uri_batch() = default;
+
+   basic_uri_batch(
+       const string_view_type& buffer, CHAR_CONTAINER separator = '\n')
+   {
+      parse(buffer, separator);
+   }
+
+   // A separator ending the buffer doesn't start a new uri, empty lines do
+   void parse(const string_view_type& buffer, CHAR_CONTAINER separator = '\n')
+   {
+      clear();
+      _buffer = buffer;
+
+      std::size_t beg = 0;
+      while(beg < buffer.size())
+      {
+         std::size_t end = buffer.find(separator, beg);
+         if(end == string_view_type::npos)
+            end = buffer.size();
+         push_back(beg, buffer.substr(beg, end - beg));
+         beg = end + 1;
+      }
+   }
+
+   void clear()
+   {
+      _buffer = string_view_type();
+      _starts.clear();
+      _sizes.clear();
+      for(auto& column : _offsets)
+         column.clear();
+      for(auto& column : _lengths)
+         column.clear();
+   }
+
+   std::size_t size() const { return _starts.size(); }
+   bool empty() const { return _starts.empty(); }
+   const string_view_type& buffer() const { return _buffer; }
+
+   string_view_type record(std::size_t index) const
+   {
+      return _buffer.substr(_starts[index], _sizes[index]);
+   }
+
+   string_view_type component(std::size_t index, uri_component c) const
+   {
+      return _buffer.substr(_starts[index] + offsets(c)[index], lengths(c)[index]);
+   }
+
+   view_type view(std::size_t index) const
+   {
+      uri_offsets result;
+      for(std::size_t c = 0; c < result.size(); ++c)
+      {
+         result[c] = uri_span{_offsets[c][index], _lengths[c][index]};
+      }
+      return view_type(record(index), result);
+   }
+
+   // position of every uri in the buffer
+   const std::vector<std::size_t>& starts() const { return _starts; }
+   const column_type& sizes() const { return _sizes; }
+
+   // position of a component, relative to the start of its uri
+   const column_type& offsets(uri_component c) const
+   {
+      return _offsets[static_cast<std::size_t>(c)];
+   }
+
+   const column_type& lengths(uri_component c) const
+   {
+      return _lengths[static_cast<std::size_t>(c)];
+   }
+
+   private:
+   void push_back(std::size_t start, const string_view_type& record)
+   {
+      uri_offsets parsed = parse_uri_offsets(record);
+      _starts.push_back(start);
+      _sizes.push_back(static_cast<std::uint32_t>(record.size()));
+      for(std::size_t c = 0; c < parsed.size(); ++c)
+      {
+         _offsets[c].push_back(parsed[c].offset);
+         _lengths[c].push_back(parsed[c].length);
+      }
+   }
+
+   enum
+   {
+      COMPONENT_COUNT = static_cast<std::size_t>(uri_component::count)
+   };
+
+   string_view_type _buffer;
+   std::vector<std::size_t> _starts;
+   column_type _sizes;
+   std::array<column_type, COMPONENT_COUNT> _offsets;
+   std::array<column_type, COMPONENT_COUNT> _lengths;
+};
+
+typedef basic_uri_batch<char> uri_batch;
+typedef basic_uri_batch<wchar_t> wuri_batch;
+}
+
+#endif //!URI_BATCH_HPP
@@ -1,18 +1,26 @@
 #ifndef URI_BUILDER_HPP
 #define URI_BUILDER_HPP
 
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include "uri.hpp"
 
 namespace xts
 {
-   template <typename CHAR>
+   // Every component is owned, through ALLOCATOR
+   // With a std::pmr::polymorphic_allocator over a monotonic_buffer_resource
+   // the segments are carved from one arena, see pmr_uri_builder
+   template <typename CHAR, typename ALLOCATOR = std::allocator<CHAR>>
    struct basic_uri_builder
    {
       typedef basic_uri<CHAR> uri;
-      typedef typename uri::string_type string_type;
+      typedef ALLOCATOR allocator_type;
+      typedef std::basic_string<CHAR, std::char_traits<CHAR>, ALLOCATOR> string_type;
       typedef typename uri::string_view_type string_view_type;
+      typedef std::vector<string_type, typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<string_type>> segments_type;
 
       basic_uri_builder() = default;
       basic_uri_builder(const basic_uri_builder&) = default;
@@ -21,48 +29,117 @@ namespace xts
       basic_uri_builder& operator=(const basic_uri_builder&) = default;
       ~basic_uri_builder() = default;
 
-      basic_uri_builder(const uri& uri)
-         : scheme(uri.scheme())
-         , username(uri.user())
-         , password(uri.password())
-         , hostname(uri.hostname())
+      explicit basic_uri_builder(const allocator_type& allocator)
+         : scheme(allocator)
+         , username(allocator)
+         , password(allocator)
+         , hostname(allocator)
+         , paths(allocator)
+         , queries(allocator)
+         , fragments(allocator)
+      {
+      }
+
+      basic_uri_builder(const uri& uri, const allocator_type& allocator = allocator_type())
+         : scheme(uri.scheme(), allocator)
+         , username(uri.user(), allocator)
+         , password(uri.password(), allocator)
+         , hostname(uri.hostname(), allocator)
          , port(uri.port())
+         , paths(convert(uri.paths(), allocator))
+         , queries(convert(uri.queries(), allocator))
+         , fragments(convert(uri.fragments(), allocator))
       {
-         auto uri_paths = uri.paths();
-         paths = convert( uri_paths.begin(), uri_paths.end() );
-         auto uri_queries = uri.queries();
-         queries = convert( uri_queries.begin(), uri_queries.end() );
-         auto uri_fragments = uri.fragments();
-         fragments = convert( uri_fragments.begin(), uri_fragments.end() );
       }
 
+      allocator_type get_allocator() const { return scheme.get_allocator(); }
+
       uri assemble() const
       {
-         return uri{assemble_to_string()};
+         typename uri::string_type result(assemble_size(), CHAR());
+         assemble_to(&result[0]);
+         return uri{std::move(result)};
       }
 
-      string_type assemble_to_string() const
+      // exact number of characters written by assemble_to
+      std::size_t assemble_size() const
       {
-         string_type result;
+         std::size_t result = 0;
 
          if (scheme.size())
-            result += scheme + ':';
-         
-         result += assemble_authority();
-         
-         for (auto& p : paths)
+            result += scheme.size() + 1;
+
+         if (hostname.size())
          {
-            result += '/' + p;
+            result += 2 + hostname.size();
+            if (username.size())
+            {
+               result += username.size() + 1;
+               if (password.size())
+                  result += password.size() + 1;
+            }
+            if (port > 0)
+               result += 1 + port_digits();
          }
+
+         for (auto& p : paths)
+            result += 1 + p.size();
          for (auto& q : queries)
+            result += 1 + q.size();
+         for (auto& f : fragments)
+            result += 1 + f.size();
+
+         return result;
+      }
+
+      // write the uri to out, a pointer to a buffer of assemble_size()
+      // characters or any output iterator, return the end of the output
+      template <typename OutputIt>
+      OutputIt assemble_to(OutputIt out) const
+      {
+         if (scheme.size())
          {
-            result += '?' + q;
+            out = std::copy(scheme.begin(), scheme.end(), out);
+            *out++ = CHAR(':');
          }
-         for (auto& f : fragments)
+
+         if (hostname.size())
          {
-            result += '#' + f;
+            *out++ = CHAR('/');
+            *out++ = CHAR('/');
+            if (username.size())
+            {
+               out = std::copy(username.begin(), username.end(), out);
+               if (password.size())
+               {
+                  *out++ = CHAR(':');
+                  out = std::copy(password.begin(), password.end(), out);
+               }
+               *out++ = CHAR('@');
+            }
+            out = std::copy(hostname.begin(), hostname.end(), out);
+            if (port > 0)
+            {
+               *out++ = CHAR(':');
+               CHAR digits[10];
+               std::size_t count = port_digits();
+               uint32_t value = port;
+               for (std::size_t i = count; i-- > 0; value /= 10)
+                  digits[i] = CHAR('0' + value % 10);
+               out = std::copy(digits, digits + count, out);
+            }
          }
 
+         out = assemble_segments(paths, CHAR('/'), out);
+         out = assemble_segments(queries, CHAR('?'), out);
+         out = assemble_segments(fragments, CHAR('#'), out);
+         return out;
+      }
+
+      string_type assemble_to_string() const
+      {
+         string_type result(assemble_size(), CHAR(), get_allocator());
+         assemble_to(&result[0]);
          return result;
       }
 
@@ -73,7 +150,7 @@ namespace xts
          paths.clear();
          for (auto& s : token)
          {
-            paths.emplace_back(s.to_string());
+            paths.emplace_back(s);
          }
       }
 
@@ -84,7 +161,7 @@ namespace xts
          queries.clear();
          for (auto& s : token)
          {
-            queries.emplace_back(s.to_string());
+            queries.emplace_back(s);
          }
       }
 
@@ -95,7 +172,7 @@ namespace xts
          fragments.clear();
          for (auto& s : token)
          {
-            fragments.emplace_back(s.to_string());
+            fragments.emplace_back(s);
          }
       }
 
@@ -104,46 +181,40 @@ namespace xts
       string_type username;
       string_type password;
       string_type hostname;
-      uint32_t port;
+      uint32_t port = 0;
 
-      std::vector<string_type> paths;
-      std::vector<string_type> queries;
-      std::vector<string_type> fragments;
+      segments_type paths;
+      segments_type queries;
+      segments_type fragments;
 
    private:
-	  string_type assemble_authority() const
-      {	
-         if (hostname.size())
-         {
-			 string_type result;
-			 result.reserve(128);
-			 result += "//";
-
-			 if (username.size())
-			 {
-				 result += username;
-				 if (password.size())
-					 result += ':' + password;
-				 result += '@';
-			 }
-
-            result += hostname;
-            if (port > 0)
-               result += ':' + std::to_string(port);
+      std::size_t port_digits() const
+      {
+         std::size_t result = 1;
+         for (uint32_t value = port; value >= 10; value /= 10)
+            ++result;
+         return result;
+      }
 
-            return result;
-         }        
-         return {};
+      template <typename OutputIt>
+      static OutputIt assemble_segments(const segments_type& segments, CHAR delimitor, OutputIt out)
+      {
+         for (auto& segment : segments)
+         {
+            *out++ = delimitor;
+            out = std::copy(segment.begin(), segment.end(), out);
+         }
+         return out;
       }
 
-      template <typename Iterator>
-      static std::vector<string_type> convert(Iterator begin, Iterator end)
+      template <typename TOKENIZER>
+      static segments_type convert(const TOKENIZER& tokenizer, const allocator_type& allocator)
       {
-         std::vector<string_type> result;
-         while (begin != end)
+         segments_type result(allocator);
+         result.reserve(tokenizer.size());
+         for (auto& segment : tokenizer)
          {
-            result.emplace_back((*begin));
-            ++begin;
+            result.emplace_back(segment);
          }
          return result;
       }
@@ -151,6 +222,8 @@ namespace xts
 
    typedef basic_uri_builder<char> uri_builder;
    typedef basic_uri_builder<wchar_t> wuri_builder;
+   typedef basic_uri_builder<char, std::pmr::polymorphic_allocator<char>> pmr_uri_builder;
+   typedef basic_uri_builder<wchar_t, std::pmr::polymorphic_allocator<wchar_t>> pmr_wuri_builder;
 }
 
 #endif //!URI_BUILDER_HPP
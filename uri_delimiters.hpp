@@ -0,0 +1,237 @@
+#ifndef URI_DELIMITERS_HPP
+#define URI_DELIMITERS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if !defined(XTS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define XTS_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if !defined(XTS_NO_SIMD) && defined(__AVX2__)
+#define XTS_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace xts
+{
+// Bit i of a delimiter_mask is set when the character i of a block is one of
+// the searched delimitors
+typedef std::uint64_t delimiter_mask;
+
+enum
+{
+   DELIMITER_BLOCK_SIZE = 64
+};
+
+inline std::size_t lowest_bit_index(delimiter_mask mask)
+{
+#ifdef _MSC_VER
+   unsigned long index;
+   _BitScanForward64(&index, mask);
+   return index;
+#else
+   return static_cast<std::size_t>(__builtin_ctzll(mask));
+#endif
+}
+
+// Reference implementation, also used for wide characters
+template <typename CHAR, CHAR... DELIMITORS>
+delimiter_mask delimiter_mask_scalar(const CHAR* block, std::size_t size)
+{
+   delimiter_mask result = 0;
+   for(std::size_t i = 0; i < size; ++i)
+   {
+      CHAR c = block[i];
+      if(((c == DELIMITORS) || ...))
+         result |= delimiter_mask(1) << i;
+   }
+   return result;
+}
+
+#ifdef XTS_HAS_SSE2
+// Expect a full block of DELIMITER_BLOCK_SIZE characters
+template <char... DELIMITORS>
+delimiter_mask delimiter_mask_sse2(const char* block)
+{
+   delimiter_mask result = 0;
+   for(std::size_t i = 0; i < DELIMITER_BLOCK_SIZE; i += 16)
+   {
+      __m128i chunk
+          = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+      __m128i found = _mm_setzero_si128();
+      ((found = _mm_or_si128(
+            found, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(DELIMITORS)))),
+          ...);
+      result |= delimiter_mask(static_cast<std::uint16_t>(_mm_movemask_epi8(found)))
+          << i;
+   }
+   return result;
+}
+#endif
+
+#ifdef XTS_HAS_AVX2
+// Expect a full block of DELIMITER_BLOCK_SIZE characters
+template <char... DELIMITORS>
+delimiter_mask delimiter_mask_avx2(const char* block)
+{
+   delimiter_mask result = 0;
+   for(std::size_t i = 0; i < DELIMITER_BLOCK_SIZE; i += 32)
+   {
+      __m256i chunk
+          = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+      __m256i found = _mm256_setzero_si256();
+      ((found = _mm256_or_si256(
+            found, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(DELIMITORS)))),
+          ...);
+      result |= delimiter_mask(static_cast<std::uint32_t>(
+                    _mm256_movemask_epi8(found)))
+          << i;
+   }
+   return result;
+}
+#endif
+
+// Classify up to DELIMITER_BLOCK_SIZE characters with the best instruction
+// set available at compile time, a partial block is padded before
+template <typename CHAR, CHAR... DELIMITORS>
+delimiter_mask delimiter_mask_of(const CHAR* block, std::size_t size)
+{
+#if defined(XTS_HAS_AVX2) || defined(XTS_HAS_SSE2)
+   if constexpr(sizeof(CHAR) == 1)
+   {
+      const char* chars = reinterpret_cast<const char*>(block);
+      char padded[DELIMITER_BLOCK_SIZE];
+      if(size < DELIMITER_BLOCK_SIZE)
+      {
+         std::memcpy(padded, chars, size);
+         std::memset(padded + size, 0, DELIMITER_BLOCK_SIZE - size);
+         chars = padded;
+      }
+#ifdef XTS_HAS_AVX2
+      delimiter_mask result
+          = delimiter_mask_avx2<static_cast<char>(DELIMITORS)...>(chars);
+#else
+      delimiter_mask result
+          = delimiter_mask_sse2<static_cast<char>(DELIMITORS)...>(chars);
+#endif
+      if(size < DELIMITER_BLOCK_SIZE)
+         result &= (delimiter_mask(1) << size) - 1;
+      return result;
+   }
+   else
+#endif
+   {
+      return delimiter_mask_scalar<CHAR, DELIMITORS...>(block, size);
+   }
+}
+
+// Walk the positions of the delimitors of a string in order, one block of
+// DELIMITER_BLOCK_SIZE characters is classified at a time
+template <typename CHAR, CHAR... DELIMITORS> class basic_delimiter_scanner
+{
+   public:
+   typedef std::basic_string_view<CHAR> string_view_type;
+
+   basic_delimiter_scanner() = default;
+   basic_delimiter_scanner(const basic_delimiter_scanner&) = default;
+   basic_delimiter_scanner(basic_delimiter_scanner&&) = default;
+   basic_delimiter_scanner& operator=(const basic_delimiter_scanner&) = default;
+   basic_delimiter_scanner& operator=(basic_delimiter_scanner&&) = default;
+   ~basic_delimiter_scanner() = default;
+
+   basic_delimiter_scanner(const string_view_type& data, std::size_t pos = 0)
+       : _data(data)
+   {
+      seek(pos);
+   }
+
+   const string_view_type& data() const { return _data; }
+
+   // position of the next delimitor, data().size() if there is none left
+   std::size_t peek()
+   {
+      while(_mask == 0)
+      {
+         if(_data.size() - _block <= DELIMITER_BLOCK_SIZE)
+            return _data.size();
+         _block += DELIMITER_BLOCK_SIZE;
+         load();
+      }
+      return _block + lowest_bit_index(_mask);
+   }
+
+   // drop the delimitor returned by peek()
+   void pop() { _mask &= _mask - 1; }
+
+   // forget every delimitor before pos
+   void seek(std::size_t pos)
+   {
+      _block = (std::min)(pos, _data.size());
+      load();
+   }
+
+   private:
+   void load()
+   {
+      std::size_t size = (std::min)(
+          _data.size() - _block, std::size_t(DELIMITER_BLOCK_SIZE));
+      _mask = size ? delimiter_mask_of<CHAR, DELIMITORS...>(
+                         _data.data() + _block, size)
+                   : 0;
+   }
+
+   string_view_type _data;
+   std::size_t _block = 0;
+   delimiter_mask _mask = 0;
+};
+
+// Same interface as basic_delimiter_scanner, one character at a time
+// Usable in constant expressions, where the intrinsics are not
+template <typename CHAR, CHAR... DELIMITORS> class basic_constexpr_delimiter_scanner
+{
+   public:
+   typedef std::basic_string_view<CHAR> string_view_type;
+
+   constexpr basic_constexpr_delimiter_scanner(
+       const string_view_type& data, std::size_t pos = 0)
+       : _data(data), _pos(pos < data.size() ? pos : data.size())
+   {
+   }
+
+   constexpr const string_view_type& data() const { return _data; }
+
+   constexpr std::size_t peek()
+   {
+      while(_pos < _data.size() && !((_data[_pos] == DELIMITORS) || ...))
+         ++_pos;
+      return _pos;
+   }
+
+   constexpr void pop()
+   {
+      if(peek() < _data.size())
+         ++_pos;
+   }
+
+   constexpr void seek(std::size_t pos)
+   {
+      _pos = pos < _data.size() ? pos : _data.size();
+   }
+
+   private:
+   string_view_type _data;
+   std::size_t _pos = 0;
+};
+}
+
+#endif //!URI_DELIMITERS_HPP
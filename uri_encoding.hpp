@@ -0,0 +1,360 @@
+#ifndef URI_ENCODING_HPP
+#define URI_ENCODING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "uri_delimiters.hpp"
+
+namespace xts
+{
+// Characters allowed unescaped, as per defined in RFC 3986
+enum class percent_encode_set : std::uint8_t
+{
+   userinfo, // unreserved sub-delims ':'
+   path, // pchar '/'
+   path_segment, // pchar
+   query, // pchar '/' '?'
+   query_param, // pchar '/' '?' without '&' '=' '+' ';'
+   fragment, // pchar '/' '?'
+};
+
+inline bool percent_encode_allowed(percent_encode_set set, unsigned char c)
+{
+   if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+      return true;
+   switch(c)
+   {
+   case '-':
+   case '.':
+   case '_':
+   case '~':
+      return true;
+   case '!':
+   case '$':
+   case '\'':
+   case '(':
+   case ')':
+   case '*':
+   case ',':
+      return true;
+   case '&':
+   case '=':
+   case '+':
+   case ';':
+      return set != percent_encode_set::query_param;
+   case ':':
+      return true;
+   case '@':
+      return set != percent_encode_set::userinfo;
+   case '/':
+      return set != percent_encode_set::userinfo
+          && set != percent_encode_set::path_segment;
+   case '?':
+      return set == percent_encode_set::query
+          || set == percent_encode_set::query_param
+          || set == percent_encode_set::fragment;
+   default:
+      return false;
+   }
+}
+
+// value of an hexadecimal digit, -1 if c isn't one
+template <typename CHAR> int hex_digit_value(CHAR c)
+{
+   if(c >= '0' && c <= '9')
+      return c - '0';
+   if(c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if(c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   return -1;
+}
+
+// Bit i is set when block[i] is an unreserved character (ALPHA DIGIT - . _ ~)
+// they never need escaping, whatever the percent_encode_set
+inline delimiter_mask unreserved_mask_scalar(const char* block, std::size_t size)
+{
+   delimiter_mask result = 0;
+   for(std::size_t i = 0; i < size; ++i)
+   {
+      unsigned char c = static_cast<unsigned char>(block[i]);
+      unsigned char lower = c | 0x20;
+      if((lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') || c == '-'
+          || c == '.' || c == '_' || c == '~')
+         result |= delimiter_mask(1) << i;
+   }
+   return result;
+}
+
+inline delimiter_mask unreserved_mask_of(const char* block, std::size_t size)
+{
+#ifdef XTS_HAS_SSE2
+   if(size == DELIMITER_BLOCK_SIZE)
+   {
+      delimiter_mask result = 0;
+      for(std::size_t i = 0; i < DELIMITER_BLOCK_SIZE; i += 16)
+      {
+         __m128i c
+             = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+         __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+         __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+             _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+         __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+             _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+         __m128i mark = _mm_or_si128(
+             _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('-')),
+                 _mm_cmpeq_epi8(c, _mm_set1_epi8('.'))),
+             _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')),
+                 _mm_cmpeq_epi8(c, _mm_set1_epi8('~'))));
+         __m128i found = _mm_or_si128(_mm_or_si128(alpha, digit), mark);
+         result |= delimiter_mask(static_cast<std::uint16_t>(_mm_movemask_epi8(found)))
+             << i;
+      }
+      return result;
+   }
+#endif
+   return unreserved_mask_scalar(block, size);
+}
+
+// Exact size of the percent encoded form of str
+inline std::size_t percent_encoded_size(std::string_view str, percent_encode_set set)
+{
+   std::size_t result = str.size();
+   for(std::size_t pos = 0; pos < str.size(); pos += DELIMITER_BLOCK_SIZE)
+   {
+      std::size_t size
+          = (std::min)(str.size() - pos, std::size_t(DELIMITER_BLOCK_SIZE));
+      delimiter_mask special = ~unreserved_mask_of(str.data() + pos, size);
+      if(size < DELIMITER_BLOCK_SIZE)
+         special &= (delimiter_mask(1) << size) - 1;
+      for(; special; special &= special - 1)
+      {
+         auto c = static_cast<unsigned char>(str[pos + lowest_bit_index(special)]);
+         if(!percent_encode_allowed(set, c))
+            result += 2;
+      }
+   }
+   return result;
+}
+
+// Write the percent encoded form of str in out, which must hold at least
+// percent_encoded_size(str, set) characters
+// Runs of unreserved characters are copied at once
+// Return the number of characters written
+inline std::size_t percent_encode(
+    std::string_view str, percent_encode_set set, char* out)
+{
+   static const char hex[] = "0123456789ABCDEF";
+   char* const out_begin = out;
+   for(std::size_t pos = 0; pos < str.size(); pos += DELIMITER_BLOCK_SIZE)
+   {
+      std::size_t size
+          = (std::min)(str.size() - pos, std::size_t(DELIMITER_BLOCK_SIZE));
+      const char* block = str.data() + pos;
+      delimiter_mask special = ~unreserved_mask_of(block, size);
+      if(size < DELIMITER_BLOCK_SIZE)
+         special &= (delimiter_mask(1) << size) - 1;
+
+      std::size_t run = 0;
+      for(; special; special &= special - 1)
+      {
+         std::size_t index = lowest_bit_index(special);
+         std::char_traits<char>::copy(out, block + run, index - run);
+         out += index - run;
+         run = index + 1;
+
+         auto c = static_cast<unsigned char>(block[index]);
+         if(percent_encode_allowed(set, c))
+         {
+            *out++ = block[index];
+         }
+         else
+         {
+            *out++ = '%';
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 0xF];
+         }
+      }
+      std::char_traits<char>::copy(out, block + run, size - run);
+      out += size - run;
+   }
+   return static_cast<std::size_t>(out - out_begin);
+}
+
+inline void append_percent_encoded(
+    std::string& out, std::string_view str, percent_encode_set set)
+{
+   std::size_t start = out.size();
+   out.resize(start + percent_encoded_size(str, set));
+   percent_encode(str, set, &out[start]);
+}
+
+// Decode the %XX sequences of str in out, which can be str.data() itself
+// With PLUS_AS_SPACE, '+' is decoded as ' ' as in form encoded data
+// Malformed sequences are kept as is, runs without any escape are located by
+// block and moved at once
+// Return the number of characters written
+template <bool PLUS_AS_SPACE = false, typename CHAR>
+std::size_t percent_decode(std::basic_string_view<CHAR> str, CHAR* out)
+{
+   typedef typename std::conditional<PLUS_AS_SPACE,
+       basic_delimiter_scanner<CHAR, '%', '+'>,
+       basic_delimiter_scanner<CHAR, '%'>>::type scanner_type;
+   scanner_type scanner(str);
+   std::size_t read = 0;
+   std::size_t written = 0;
+   while(read < str.size())
+   {
+      std::size_t next = scanner.peek();
+      if(next < read)
+      {
+         // a block loaded after an in place write, already handled
+         scanner.pop();
+         continue;
+      }
+
+      if(next > read)
+      {
+         if(out + written != str.data() + read)
+            std::char_traits<CHAR>::move(out + written, str.data() + read, next - read);
+         written += next - read;
+         read = next;
+         if(read == str.size())
+            break;
+      }
+      scanner.pop();
+
+      CHAR c = str[read];
+      if(PLUS_AS_SPACE && c == '+')
+      {
+         out[written++] = ' ';
+         ++read;
+         continue;
+      }
+
+      int high = read + 2 < str.size() ? hex_digit_value(str[read + 1]) : -1;
+      int low = high >= 0 ? hex_digit_value(str[read + 2]) : -1;
+      if(low >= 0)
+      {
+         out[written++] = static_cast<CHAR>(high * 16 + low);
+         read += 3;
+      }
+      else
+      {
+         out[written++] = c;
+         ++read;
+      }
+   }
+   return written;
+}
+
+template <bool PLUS_AS_SPACE = false, typename CHAR>
+std::size_t percent_decode(std::basic_string<CHAR>& str)
+{
+   str.resize(percent_decode<PLUS_AS_SPACE>(
+       std::basic_string_view<CHAR>(str), &str[0]));
+   return str.size();
+}
+
+template <typename CHAR, bool PLUS_AS_SPACE = false>
+bool need_percent_decode(std::basic_string_view<CHAR> str)
+{
+   return str.find('%') != std::basic_string_view<CHAR>::npos
+       || (PLUS_AS_SPACE && str.find('+') != std::basic_string_view<CHAR>::npos);
+}
+
+// Range over the segments of a tokenizer, percent decoded when dereferenced
+// Segments without escape are returned as is, the others are decoded in a
+// buffer owned by the iterator and reused from one segment to the next
+template <typename TOKENIZER, bool PLUS_AS_SPACE = false>
+class basic_percent_decoded_tokens
+{
+   public:
+   typedef typename TOKENIZER::string_view_type string_view_type;
+   typedef typename TOKENIZER::string_type string_type;
+   typedef typename string_view_type::value_type char_type;
+
+   class const_iterator
+   {
+      public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef string_view_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const string_view_type* pointer;
+      typedef const string_view_type& reference;
+
+      const_iterator() = default;
+      explicit const_iterator(const typename TOKENIZER::const_iterator& it)
+          : _it(it)
+      {
+      }
+
+      reference operator*() const
+      {
+         if(!_decoded)
+         {
+            _current = *_it;
+            if(need_percent_decode<char_type, PLUS_AS_SPACE>(_current))
+            {
+               _buffer.assign(_current.data(), _current.size());
+               percent_decode<PLUS_AS_SPACE>(_buffer);
+               _current = _buffer;
+            }
+            _decoded = true;
+         }
+         return _current;
+      }
+
+      pointer operator->() const { return &operator*(); }
+
+      const_iterator& operator++()
+      {
+         ++_it;
+         _decoded = false;
+         return *this;
+      }
+
+      const_iterator operator++(int)
+      {
+         const_iterator result = *this;
+         ++(*this);
+         return result;
+      }
+
+      bool operator==(const const_iterator& rhs) const { return _it == rhs._it; }
+      bool operator!=(const const_iterator& rhs) const { return _it != rhs._it; }
+
+      private:
+      typename TOKENIZER::const_iterator _it;
+      mutable string_type _buffer;
+      mutable string_view_type _current;
+      mutable bool _decoded = false;
+   };
+   typedef const_iterator iterator;
+
+   basic_percent_decoded_tokens() = default;
+   explicit basic_percent_decoded_tokens(const TOKENIZER& tokens)
+       : _tokens(tokens)
+   {
+   }
+
+   const_iterator begin() const { return const_iterator(_tokens.begin()); }
+   const_iterator end() const { return const_iterator(_tokens.end()); }
+
+   private:
+   TOKENIZER _tokens;
+};
+
+template <bool PLUS_AS_SPACE = false, typename TOKENIZER>
+basic_percent_decoded_tokens<TOKENIZER, PLUS_AS_SPACE> percent_decoded(
+    const TOKENIZER& tokens)
+{
+   return basic_percent_decoded_tokens<TOKENIZER, PLUS_AS_SPACE>(tokens);
+}
+}
+
+#endif //!URI_ENCODING_HPP
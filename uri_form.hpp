@@ -0,0 +1,175 @@
+#ifndef URI_FORM_HPP
+#define URI_FORM_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "uri.hpp"
+#include "uri_encoding.hpp"
+
+namespace xts
+{
+// Push parser of an application/x-www-form-urlencoded body received in any
+// number of chunks
+// The pairs are split by for_each_query_pair as for query_params, the keys
+// and values are percent decoded with '+' as space and given to
+// callback(key, value), valid during the call only
+// Only the pair crossing the end of a chunk is kept until the next one, the
+// body is never buffered as a whole
+// A pair longer than max_pair characters is dropped and counted by
+// dropped(), wherever the chunks are cut, so a huge value never cost more
+// than max_pair characters
+template <typename CHAR_CONTAINER> class basic_form_parser
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   enum : std::size_t
+   {
+      DEFAULT_MAX_PAIR = std::size_t(1) << 20
+   };
+
+   explicit basic_form_parser(std::size_t max_pair = DEFAULT_MAX_PAIR)
+       : _max_pair(max_pair)
+   {
+   }
+
+   basic_form_parser(const basic_form_parser&) = default;
+   basic_form_parser(basic_form_parser&&) = default;
+   basic_form_parser& operator=(const basic_form_parser&) = default;
+   basic_form_parser& operator=(basic_form_parser&&) = default;
+   ~basic_form_parser() = default;
+
+   // The chunk is decoded in place, its content is undefined afterward
+   template <typename CALLBACK>
+   void feed(CHAR_CONTAINER* chunk, std::size_t size, CALLBACK&& callback)
+   {
+      split(string_view_type(chunk, size), chunk, callback);
+   }
+
+   // The pairs needing decoding are decoded in a buffer reused between pairs
+   template <typename CALLBACK>
+   void feed(const string_view_type& chunk, CALLBACK&& callback)
+   {
+      split(chunk, nullptr, callback);
+   }
+
+   // the body is complete, the last pair is given
+   template <typename CALLBACK> void finish(CALLBACK&& callback)
+   {
+      if(!_skipping && !_pending.empty())
+         emit(string_view_type(_pending), &_pending[0], callback);
+      _pending.clear();
+      _skipping = false;
+   }
+
+   void reset()
+   {
+      _pending.clear();
+      _scratch.clear();
+      _skipping = false;
+      _dropped = 0;
+   }
+
+   // characters kept from the previous chunks, at most max_pair + 1
+   std::size_t pending() const { return _pending.size(); }
+   // pairs longer than max_pair since the last reset
+   std::size_t dropped() const { return _dropped; }
+
+   private:
+   // The text after the last '&' is kept with its '&', so that only the
+   // start of the body can have its '?' skipped
+   template <typename CALLBACK>
+   void split(const string_view_type& chunk, CHAR_CONTAINER* writable,
+       CALLBACK& callback)
+   {
+      const std::size_t first = chunk.find('&');
+      if(first == string_view_type::npos)
+      {
+         keep(chunk);
+         return;
+      }
+
+      if(_pending.empty() && !_skipping)
+         emit(chunk.substr(0, first), writable, callback);
+      else
+      {
+         keep(chunk.substr(0, first));
+         if(!_skipping)
+            emit(string_view_type(_pending), &_pending[0], callback);
+         _pending.clear();
+         _skipping = false;
+      }
+
+      const std::size_t last = chunk.rfind('&');
+      emit(chunk.substr(first, last - first),
+          writable != nullptr ? writable + first : nullptr, callback);
+      keep(chunk.substr(last));
+   }
+
+   // the pair is dropped once it can't fit max_pair characters
+   void keep(const string_view_type& text)
+   {
+      if(_skipping)
+         return;
+      if(_pending.size() + text.size() > _max_pair + 1)
+      {
+         _pending.clear();
+         _skipping = true;
+         ++_dropped;
+         return;
+      }
+      _pending.append(text.data(), text.size());
+   }
+
+   // Give the pairs of text, decoded in writable when it is the memory of
+   // text, in _scratch otherwise
+   template <typename CALLBACK>
+   void emit(const string_view_type& text, CHAR_CONTAINER* writable,
+       CALLBACK& callback)
+   {
+      for_each_query_pair(text,
+          [&](const string_view_type& key, const string_view_type& value) {
+             const std::size_t size
+                 = static_cast<std::size_t>(value.data() + value.size() - key.data());
+             if(size > _max_pair)
+             {
+                ++_dropped;
+                return;
+             }
+             CHAR_CONTAINER* out;
+             if(writable != nullptr)
+                out = writable + (key.data() - text.data());
+             else if(!need_percent_decode<CHAR_CONTAINER, true>(key)
+                 && !need_percent_decode<CHAR_CONTAINER, true>(value))
+             {
+                callback(key, value);
+                return;
+             }
+             else
+             {
+                _scratch.resize(size);
+                out = &_scratch[0];
+             }
+             CHAR_CONTAINER* value_out = out + (value.data() - key.data());
+             const std::size_t key_size = percent_decode<true>(key, out);
+             const std::size_t value_size = percent_decode<true>(value, value_out);
+             callback(string_view_type(out, key_size),
+                 string_view_type(value_out, value_size));
+          });
+   }
+
+   string_type _pending;
+   string_type _scratch;
+   std::size_t _max_pair;
+   std::size_t _dropped = 0;
+   // the pair crossing the chunks is too long, skip it up to the next '&'
+   bool _skipping = false;
+};
+
+typedef basic_form_parser<char> form_parser;
+typedef basic_form_parser<wchar_t> wform_parser;
+}
+
+#endif //!URI_FORM_HPP
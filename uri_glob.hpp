@@ -0,0 +1,413 @@
+#ifndef URI_GLOB_HPP
+#define URI_GLOB_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "uri.hpp"
+#include "uri_query.hpp"
+#include "uri_segment_trie.hpp"
+
+namespace xts
+{
+// Set of glob patterns over the segments of a path ('/') or the labels of a
+// hostname ('.'), compiled into one automaton walked once per input
+// A pattern segment is either a literal, "*" matching one segment, "**"
+// matching any number of segments, possibly none, or a glob where '*' match
+// any characters and '?' one character inside the segment
+// The patterns share a trie, the automaton follow every active node at once:
+// a literal segment is found by binary search and the globs of a node are
+// grouped by the literal suffix after their last wildcard, only the groups
+// whose suffix end the segment are tried
+// The cost of a segment thus grows with the active nodes and with the globs
+// sharing a suffix, such as *.js and app-*.js, not with the whole set
+// Hostnames are walked from their last label, so that patterns such as
+// *.example.com share their suffix; nothing is case folded, normalize first
+template <typename CHAR_CONTAINER, CHAR_CONTAINER SEPARATOR> class basic_glob_set
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_tokenizer<CHAR_CONTAINER, SEPARATOR> tokenizer_type;
+   // index of each matching pattern, in increasing order
+   typedef basic_inline_vector<std::uint32_t, 8> match_set;
+
+   static constexpr std::uint32_t npos = 0xFFFFFFFF;
+
+   basic_glob_set(const basic_glob_set&) = delete;
+   basic_glob_set& operator=(const basic_glob_set&) = delete;
+
+   // RANGE of patterns, the index of a pattern is its rank in the range
+   template <typename RANGE> explicit basic_glob_set(const RANGE& patterns)
+   {
+      for(auto& p : patterns)
+         add(string_view_type(p));
+      compile();
+   }
+
+   basic_glob_set(std::initializer_list<string_view_type> patterns)
+   {
+      for(auto& p : patterns)
+         add(p);
+      compile();
+   }
+
+   std::size_t size() const { return _patterns.size(); }
+   const string_type& operator[](std::size_t i) const { return _patterns[i]; }
+   std::size_t state_count() const { return _states.size(); }
+
+   match_set match(const string_view_type& input) const
+   {
+      active_set active = walk(input);
+      match_set result;
+      for(std::size_t i = 0; i < active.size(); ++i)
+      {
+         const state& s = _states[active[i]];
+         for(std::uint32_t t = s.first_terminal; t < s.first_terminal + s.terminal_count; ++t)
+            result.push_back(_terminals[t]);
+      }
+      std::sort(result.data(), result.data() + result.size());
+      return result;
+   }
+
+   bool matches(const string_view_type& input) const
+   {
+      active_set active = walk(input);
+      for(std::size_t i = 0; i < active.size(); ++i)
+      {
+         if(_states[active[i]].terminal_count != 0)
+            return true;
+      }
+      return false;
+   }
+
+   private:
+   // kept by each node of the trie along its literal children
+   struct node_data
+   {
+      std::vector<std::pair<string_type, std::uint32_t>> globs;
+      std::uint32_t star = npos;
+      std::uint32_t globstar = npos;
+      std::vector<std::uint32_t> terminals;
+   };
+
+   typedef basic_segment_trie<CHAR_CONTAINER, node_data> trie_type;
+   typedef basic_segment_edges<CHAR_CONTAINER> edges_type;
+   typedef typename edges_type::edge edge;
+
+   // glob edges of a node whose literal suffix has the same length, sorted
+   // by suffix
+   struct glob_group
+   {
+      std::uint32_t suffix_length;
+      std::uint32_t first_edge;
+      std::uint32_t edge_count;
+   };
+
+   struct state
+   {
+      // literal edges sorted by segment
+      std::uint32_t first_edge = 0;
+      std::uint32_t literal_count = 0;
+      // groups sorted by suffix length
+      std::uint32_t first_group = 0;
+      std::uint32_t group_count = 0;
+      std::uint32_t star = npos;
+      // reached without consuming a segment
+      std::uint32_t globstar = npos;
+      // entered through "**", stay active on any segment
+      bool loop = false;
+      std::uint32_t first_terminal = 0;
+      std::uint32_t terminal_count = 0;
+   };
+
+   // segments in walking order
+   template <typename CALLBACK>
+   static void for_each_segment(const string_view_type& input, CALLBACK callback)
+   {
+      if(SEPARATOR != '.')
+      {
+         tokenizer_type tokenizer(input);
+         for(auto& segment : tokenizer)
+            callback(segment);
+         return;
+      }
+      if(input.empty())
+         return;
+      std::size_t end = input.size();
+      for(;;)
+      {
+         const std::size_t found = input.rfind(SEPARATOR, end - 1);
+         const std::size_t beg = found == string_view_type::npos ? 0 : found + 1;
+         callback(input.substr(beg, end - beg));
+         if(found == string_view_type::npos)
+            break;
+         end = found;
+         if(end == 0)
+         {
+            callback(string_view_type());
+            break;
+         }
+      }
+   }
+
+   void add(const string_view_type& pattern)
+   {
+      _patterns.emplace_back(pattern);
+      const std::uint32_t index = static_cast<std::uint32_t>(_patterns.size() - 1);
+
+      std::uint32_t current = 0;
+      for_each_segment(pattern, [&](const string_view_type& segment) {
+         if(segment.size() == 2 && segment[0] == '*' && segment[1] == '*')
+            current = _trie.child(current, &node_data::globstar);
+         else if(segment.size() == 1 && segment[0] == '*')
+            current = _trie.child(current, &node_data::star);
+         else if(segment.find_first_of(wildcards()) != string_view_type::npos)
+         {
+            auto& globs = _trie[current].globs;
+            auto found = std::find_if(globs.begin(), globs.end(),
+                [&segment](const std::pair<string_type, std::uint32_t>& g) {
+                   return string_view_type(g.first) == segment;
+                });
+            if(found == globs.end())
+            {
+               const std::uint32_t child = _trie.new_node();
+               _trie[current].globs.emplace_back(string_type(segment), child);
+               current = child;
+            }
+            else
+               current = found->second;
+         }
+         else
+            current = _trie.literal(current, segment);
+      });
+      _trie[current].terminals.push_back(index);
+   }
+
+   static const CHAR_CONTAINER* wildcards()
+   {
+      static const CHAR_CONTAINER result[] = {'*', '?', 0};
+      return result;
+   }
+
+   // flatten the trie, the nodes keep their index
+   void compile()
+   {
+      _states.resize(_trie.size());
+      for(std::uint32_t id = 0; id < _trie.size(); ++id)
+      {
+         const auto& n = _trie[id];
+         state& s = _states[id];
+         s.first_edge = _edges.size();
+         s.literal_count = static_cast<std::uint32_t>(n.literals.size());
+         for(auto& l : n.literals)
+            _edges.push_back(l.first, l.second);
+         push_globs(s, n.globs);
+         s.star = n.star;
+         s.globstar = n.globstar;
+         if(n.globstar != npos)
+            _states[n.globstar].loop = true;
+         s.first_terminal = static_cast<std::uint32_t>(_terminals.size());
+         s.terminal_count = static_cast<std::uint32_t>(n.terminals.size());
+         _terminals.insert(_terminals.end(), n.terminals.begin(), n.terminals.end());
+      }
+      _trie.clear();
+   }
+
+   static std::size_t suffix_length(const string_view_type& glob)
+   {
+      return glob.size() - 1 - glob.find_last_of(wildcards());
+   }
+
+   static string_view_type suffix_of(const string_view_type& text, std::size_t length)
+   {
+      return text.substr(text.size() - length);
+   }
+
+   void push_globs(state& s,
+       std::vector<std::pair<string_type, std::uint32_t>> globs)
+   {
+      std::sort(globs.begin(), globs.end(),
+          [](const std::pair<string_type, std::uint32_t>& lhs,
+              const std::pair<string_type, std::uint32_t>& rhs) {
+             const std::size_t l = suffix_length(lhs.first);
+             const std::size_t r = suffix_length(rhs.first);
+             if(l != r)
+                return l < r;
+             return suffix_of(lhs.first, l) < suffix_of(rhs.first, r);
+          });
+      s.first_group = static_cast<std::uint32_t>(_groups.size());
+      for(auto& g : globs)
+      {
+         const std::uint32_t length
+             = static_cast<std::uint32_t>(suffix_length(g.first));
+         if(_groups.size() == s.first_group
+             || _groups.back().suffix_length != length)
+            _groups.push_back(glob_group{length, _edges.size(), 0});
+         ++_groups.back().edge_count;
+         _edges.push_back(g.first, g.second);
+      }
+      s.group_count = static_cast<std::uint32_t>(_groups.size() - s.first_group);
+   }
+
+   // States of one step, deduplicated by a stamp per state, the stamps are
+   // kept per thread and reused from one walk to the next
+   class active_set
+   {
+      public:
+      active_set(std::uint32_t* stamps, std::uint32_t generation)
+          : _stamps(stamps), _generation(generation)
+      {
+      }
+
+      std::size_t size() const { return _states.size(); }
+      std::uint32_t operator[](std::size_t i) const { return _states[i]; }
+
+      bool insert(std::uint32_t id)
+      {
+         if(_stamps[id] == _generation)
+            return false;
+         _stamps[id] = _generation;
+         _states.push_back(id);
+         return true;
+      }
+
+      private:
+      std::uint32_t* _stamps;
+      std::uint32_t _generation;
+      basic_inline_vector<std::uint32_t, 32> _states;
+   };
+
+   struct stamps
+   {
+      std::vector<std::uint32_t> values;
+      std::uint32_t generation = 0;
+
+      active_set next(std::size_t size)
+      {
+         if(values.size() < size)
+            values.resize(size, 0);
+         if(++generation == 0)
+         {
+            std::fill(values.begin(), values.end(), 0);
+            generation = 1;
+         }
+         return active_set(values.data(), generation);
+      }
+   };
+
+   static stamps& thread_stamps()
+   {
+      static thread_local stamps result;
+      return result;
+   }
+
+   // add a state and the states reached through "**"
+   void activate(active_set& set, std::uint32_t id) const
+   {
+      for(; id != npos && set.insert(id); id = _states[id].globstar)
+      {
+      }
+   }
+
+   static bool glob_match(string_view_type glob, string_view_type segment)
+   {
+      // greedy match with a single backtrack point per '*'
+      std::size_t g = 0;
+      std::size_t s = 0;
+      std::size_t star = string_view_type::npos;
+      std::size_t resume = 0;
+      while(s < segment.size())
+      {
+         if(g < glob.size() && (glob[g] == '?' || glob[g] == segment[s]))
+         {
+            ++g;
+            ++s;
+         }
+         else if(g < glob.size() && glob[g] == '*')
+         {
+            star = g++;
+            resume = s;
+         }
+         else if(star != string_view_type::npos)
+         {
+            g = star + 1;
+            s = ++resume;
+         }
+         else
+            return false;
+      }
+      while(g < glob.size() && glob[g] == '*')
+         ++g;
+      return g == glob.size();
+   }
+
+   active_set walk(const string_view_type& input) const
+   {
+      stamps& stamp = thread_stamps();
+      active_set current = stamp.next(_states.size());
+      activate(current, 0);
+      for_each_segment(input, [&](const string_view_type& segment) {
+         active_set next = stamp.next(_states.size());
+         for(std::size_t i = 0; i < current.size(); ++i)
+         {
+            const state& s = _states[current[i]];
+            if(s.loop)
+               activate(next, current[i]);
+            const edge* found = _edges.find(s.first_edge, s.literal_count, segment);
+            if(found != nullptr)
+               activate(next, found->next);
+
+            const glob_group* group = _groups.data() + s.first_group;
+            for(const glob_group* g = group; g != group + s.group_count; ++g)
+            {
+               if(g->suffix_length > segment.size())
+                  break;
+               const string_view_type tail = suffix_of(segment, g->suffix_length);
+               const edge* beg = _edges.data() + g->first_edge;
+               const edge* end = beg + g->edge_count;
+               const std::size_t length = g->suffix_length;
+               for(const edge* e = std::lower_bound(beg, end, tail,
+                       [this, length](const edge& e, const string_view_type& key) {
+                          return suffix_of(_edges.label(e), length) < key;
+                       });
+                   e != end && suffix_of(_edges.label(*e), length) == tail; ++e)
+               {
+                  if(glob_match(_edges.label(*e), segment))
+                     activate(next, e->next);
+               }
+            }
+            if(s.star != npos)
+               activate(next, s.star);
+         }
+         current = std::move(next);
+      });
+      return current;
+   }
+
+   std::vector<string_type> _patterns;
+   std::vector<state> _states;
+   edges_type _edges;
+   std::vector<glob_group> _groups;
+   std::vector<std::uint32_t> _terminals;
+
+   // only used while compiling
+   trie_type _trie;
+};
+
+template <typename CHAR_CONTAINER>
+using basic_path_glob_set = basic_glob_set<CHAR_CONTAINER, '/'>;
+template <typename CHAR_CONTAINER>
+using basic_host_glob_set = basic_glob_set<CHAR_CONTAINER, '.'>;
+
+typedef basic_path_glob_set<char> path_glob_set;
+typedef basic_path_glob_set<wchar_t> wpath_glob_set;
+typedef basic_host_glob_set<char> host_glob_set;
+typedef basic_host_glob_set<wchar_t> whost_glob_set;
+}
+
+#endif //!URI_GLOB_HPP
@@ -0,0 +1,538 @@
+#ifndef URI_INTERN_HPP
+#define URI_INTERN_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "uri.hpp"
+
+namespace xts
+{
+typedef std::uint32_t intern_handle;
+static constexpr intern_handle intern_npos = 0xFFFFFFFF;
+
+// Append only storage addressed by 32 bits handles, elements never move
+// One writer at a time, readers never lock
+// It holds at most MAX_SIZE elements, intern_npos is never a handle
+// The elements are allocated by blocks of 2^BLOCK_POWER, the directory of
+// blocks by pages of 2^PAGE_POWER entries, both when first written: an
+// empty store only hold the table of pages
+template <typename T, std::size_t BLOCK_POWER = 12> class basic_segmented_store
+{
+   public:
+   enum : std::size_t
+   {
+      BLOCK_SIZE = std::size_t(1) << BLOCK_POWER,
+      MAX_BLOCKS = (std::size_t(1) << 32) >> BLOCK_POWER,
+      PAGE_POWER = (32 - BLOCK_POWER) / 2,
+      PAGE_SIZE = std::size_t(1) << PAGE_POWER,
+      PAGE_COUNT = MAX_BLOCKS >> PAGE_POWER,
+      MAX_SIZE = intern_npos
+   };
+
+   basic_segmented_store()
+   {
+      for(auto& page : _pages)
+         page.store(nullptr, std::memory_order_relaxed);
+   }
+
+   basic_segmented_store(const basic_segmented_store&) = delete;
+   basic_segmented_store& operator=(const basic_segmented_store&) = delete;
+
+   ~basic_segmented_store()
+   {
+      for(auto& p : _pages)
+      {
+         std::atomic<T*>* page = p.load(std::memory_order_relaxed);
+         if(page == nullptr)
+            continue;
+         for(std::size_t i = 0; i < PAGE_SIZE; ++i)
+            delete[] page[i].load(std::memory_order_relaxed);
+         delete[] page;
+      }
+   }
+
+   // writer only, intern_npos when the store is full
+   intern_handle push_back(const T& value)
+   {
+      std::size_t index = _size.load(std::memory_order_relaxed);
+      if(index >= MAX_SIZE)
+         return intern_npos;
+      std::size_t block_index = index >> BLOCK_POWER;
+      std::atomic<std::atomic<T*>*>& p = _pages[block_index >> PAGE_POWER];
+      std::atomic<T*>* page = p.load(std::memory_order_relaxed);
+      if(page == nullptr)
+      {
+         page = new std::atomic<T*>[PAGE_SIZE];
+         for(std::size_t i = 0; i < PAGE_SIZE; ++i)
+            page[i].store(nullptr, std::memory_order_relaxed);
+         p.store(page, std::memory_order_release);
+      }
+      std::atomic<T*>& b = page[block_index & (PAGE_SIZE - 1)];
+      T* block = b.load(std::memory_order_relaxed);
+      if(block == nullptr)
+      {
+         block = new T[BLOCK_SIZE];
+         b.store(block, std::memory_order_release);
+      }
+      block[index & (BLOCK_SIZE - 1)] = value;
+      _size.store(index + 1, std::memory_order_release);
+      return static_cast<intern_handle>(index);
+   }
+
+   // handle must come from push_back
+   const T& operator[](intern_handle handle) const
+   {
+      const std::size_t block_index = handle >> BLOCK_POWER;
+      const std::atomic<T*>* page
+          = _pages[block_index >> PAGE_POWER].load(std::memory_order_acquire);
+      const T* block = page[block_index & (PAGE_SIZE - 1)].load(
+          std::memory_order_acquire);
+      return block[handle & (BLOCK_SIZE - 1)];
+   }
+
+   std::size_t size() const { return _size.load(std::memory_order_acquire); }
+   bool full() const { return size() >= MAX_SIZE; }
+
+   private:
+   std::atomic<std::atomic<T*>*> _pages[PAGE_COUNT];
+   std::atomic<std::size_t> _size{0};
+};
+
+// Open addressing index from a 32 bits hash to a handle
+// Growing publish a new table, the previous ones stay alive for the readers
+// still walking them, so lookups never lock
+// Until reclaim() is called the outgrown tables take as much memory as the
+// current one
+class intern_index
+{
+   public:
+   intern_index() { grow(16); }
+   intern_index(const intern_index&) = delete;
+   intern_index& operator=(const intern_index&) = delete;
+
+   // EQUAL is called with each candidate handle of the same hash
+   template <typename EQUAL>
+   intern_handle find(std::uint32_t hash, const EQUAL& equal) const
+   {
+      const table* t = _current.load(std::memory_order_acquire);
+      for(std::size_t i = hash & t->mask;; i = (i + 1) & t->mask)
+      {
+         std::uint64_t slot = t->slots[i].load(std::memory_order_acquire);
+         if(slot == 0)
+            return intern_npos;
+         if(static_cast<std::uint32_t>(slot >> 32) == hash)
+         {
+            intern_handle handle = static_cast<intern_handle>(slot) - 1;
+            if(equal(handle))
+               return handle;
+         }
+      }
+   }
+
+   // writer only
+   void insert(std::uint32_t hash, intern_handle handle)
+   {
+      table* t = _tables.back().get();
+      if((_count + 1) * 2 > t->mask + 1)
+      {
+         grow((t->mask + 1) * 2);
+         t = _tables.back().get();
+      }
+      place(*t, (std::uint64_t(hash) << 32) | (std::uint64_t(handle) + 1));
+      ++_count;
+   }
+
+   std::size_t size() const { return _count; }
+
+   // writer only, free the outgrown tables
+   // no reader may be running find() concurrently
+   void reclaim()
+   {
+      if(_tables.size() > 1)
+         _tables.erase(_tables.begin(), _tables.end() - 1);
+   }
+
+   private:
+   struct table
+   {
+      std::size_t mask;
+      std::unique_ptr<std::atomic<std::uint64_t>[]> slots;
+   };
+
+   static void place(table& t, std::uint64_t slot)
+   {
+      std::size_t i = static_cast<std::uint32_t>(slot >> 32) & t.mask;
+      while(t.slots[i].load(std::memory_order_relaxed) != 0)
+         i = (i + 1) & t.mask;
+      t.slots[i].store(slot, std::memory_order_release);
+   }
+
+   void grow(std::size_t capacity)
+   {
+      std::unique_ptr<table> t(new table{capacity - 1,
+          std::unique_ptr<std::atomic<std::uint64_t>[]>(
+              new std::atomic<std::uint64_t>[capacity])});
+      for(std::size_t i = 0; i < capacity; ++i)
+         t->slots[i].store(0, std::memory_order_relaxed);
+
+      if(!_tables.empty())
+      {
+         const table& old = *_tables.back();
+         for(std::size_t i = 0; i <= old.mask; ++i)
+         {
+            std::uint64_t slot = old.slots[i].load(std::memory_order_relaxed);
+            if(slot != 0)
+               place(*t, slot);
+         }
+      }
+      _current.store(t.get(), std::memory_order_release);
+      _tables.push_back(std::move(t));
+   }
+
+   std::atomic<const table*> _current{nullptr};
+   std::vector<std::unique_ptr<table>> _tables;
+   std::size_t _count = 0;
+};
+
+// Deduplicated strings addressed by 32 bits handles, the handle 0 is the
+// empty string
+// intern() serialize the writers, find() and operator[] never lock, it
+// returns intern_npos once 2^32 - 1 strings are stored
+// The characters are packed in chunks of CHUNK_SIZE, the index keeps its
+// outgrown tables until reclaim()
+template <typename CHAR_CONTAINER> class basic_string_intern_pool
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   basic_string_intern_pool() { intern(string_view_type()); }
+   basic_string_intern_pool(const basic_string_intern_pool&) = delete;
+   basic_string_intern_pool& operator=(const basic_string_intern_pool&) = delete;
+
+   intern_handle find(const string_view_type& str) const
+   {
+      return _index.find(hash_of(str),
+          [this, &str](intern_handle handle) { return (*this)[handle] == str; });
+   }
+
+   intern_handle intern(const string_view_type& str)
+   {
+      std::lock_guard<std::mutex> lock(_writer);
+      std::uint32_t hash = hash_of(str);
+      intern_handle handle = _index.find(hash,
+          [this, &str](intern_handle handle) { return (*this)[handle] == str; });
+      if(handle != intern_npos)
+         return handle;
+
+      if(_entries.full())
+         return intern_npos;
+      handle = _entries.push_back(
+          entry{store(str), static_cast<std::uint32_t>(str.size())});
+      _index.insert(hash, handle);
+      return handle;
+   }
+
+   string_view_type operator[](intern_handle handle) const
+   {
+      const entry& e = _entries[handle];
+      return string_view_type(e.data, e.size);
+   }
+
+   std::size_t size() const { return _entries.size(); }
+
+   // free the memory kept for concurrent readers
+   // no find() nor operator[] may be running meanwhile
+   void reclaim()
+   {
+      std::lock_guard<std::mutex> lock(_writer);
+      _index.reclaim();
+   }
+
+   private:
+   struct entry
+   {
+      const CHAR_CONTAINER* data = nullptr;
+      std::uint32_t size = 0;
+   };
+
+   enum
+   {
+      CHUNK_SIZE = 1 << 16
+   };
+
+   static std::uint32_t hash_of(const string_view_type& str)
+   {
+      return fold_hash(hash_uri_data(str));
+   }
+
+   // writer only, the characters are packed in chunks that never move
+   const CHAR_CONTAINER* store(const string_view_type& str)
+   {
+      if(str.empty())
+         return nullptr;
+      if(str.size() > CHUNK_SIZE - _used)
+      {
+         std::size_t size = (std::max)(str.size(), std::size_t(CHUNK_SIZE));
+         _chunks.emplace_back(new CHAR_CONTAINER[size]);
+         _used = size == CHUNK_SIZE ? 0 : CHUNK_SIZE;
+         if(size != CHUNK_SIZE)
+         {
+            std::char_traits<CHAR_CONTAINER>::copy(
+                _chunks.back().get(), str.data(), str.size());
+            return _chunks.back().get();
+         }
+      }
+      CHAR_CONTAINER* result = _chunks.back().get() + _used;
+      std::char_traits<CHAR_CONTAINER>::copy(result, str.data(), str.size());
+      _used += str.size();
+      return result;
+   }
+
+   basic_segmented_store<entry> _entries;
+   intern_index _index;
+   std::vector<std::unique_ptr<CHAR_CONTAINER[]>> _chunks;
+   std::size_t _used = CHUNK_SIZE;
+   std::mutex _writer;
+};
+
+// Deduplicated uris addressed by 32 bits handles
+// Every component is interned in a shared string pool, the path being cut
+// in its directory and its last segment, so an uri cost one record of
+// handles, and the common hosts, schemes and directories are stored once
+// intern() serialize the writers, find() and the accessors never lock
+// As for the string pool, reclaim() free the outgrown index tables and
+// intern() return intern_npos when the records or the strings are full
+template <typename CHAR_CONTAINER> class basic_uri_intern_table
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+   typedef basic_string_intern_pool<CHAR_CONTAINER> pool_type;
+
+   basic_uri_intern_table() = default;
+   basic_uri_intern_table(const basic_uri_intern_table&) = delete;
+   basic_uri_intern_table& operator=(const basic_uri_intern_table&) = delete;
+
+   intern_handle find(const view_type& uri) const
+   {
+      record r;
+      if(!make_record(uri, r, [this](const string_view_type& str) {
+            return _strings.find(str);
+         }))
+         return intern_npos;
+      return _index.find(hash_of(r),
+          [this, &r](intern_handle handle) { return _records[handle] == r; });
+   }
+
+   intern_handle intern(const view_type& uri)
+   {
+      record r;
+      if(!make_record(uri, r, [this](const string_view_type& str) {
+            return _strings.intern(str);
+         }))
+         return intern_npos;
+
+      std::lock_guard<std::mutex> lock(_writer);
+      std::uint32_t hash = hash_of(r);
+      intern_handle handle = _index.find(hash,
+          [this, &r](intern_handle handle) { return _records[handle] == r; });
+      if(handle != intern_npos)
+         return handle;
+
+      handle = _records.push_back(r);
+      if(handle != intern_npos)
+         _index.insert(hash, handle);
+      return handle;
+   }
+
+   std::size_t size() const { return _records.size(); }
+   const pool_type& strings() const { return _strings; }
+
+   // no find() nor accessor may be running meanwhile
+   void reclaim()
+   {
+      _strings.reclaim();
+      std::lock_guard<std::mutex> lock(_writer);
+      _index.reclaim();
+   }
+
+   string_view_type scheme(intern_handle handle) const
+   {
+      return component(handle, SCHEME);
+   }
+
+   string_view_type userinfo(intern_handle handle) const
+   {
+      return component(handle, USERINFO);
+   }
+
+   string_view_type hostname(intern_handle handle) const
+   {
+      return component(handle, HOSTNAME);
+   }
+
+   string_view_type query(intern_handle handle) const
+   {
+      return component(handle, QUERY);
+   }
+
+   string_view_type fragment(intern_handle handle) const
+   {
+      return component(handle, FRAGMENT);
+   }
+
+   // path up to its last '/' included
+   string_view_type path_directory(intern_handle handle) const
+   {
+      return component(handle, DIRECTORY);
+   }
+
+   string_view_type path_leaf(intern_handle handle) const
+   {
+      return component(handle, LEAF);
+   }
+
+   // rebuild the exact interned data
+   string_type to_string(intern_handle handle) const
+   {
+      const record& r = _records[handle];
+      string_type result;
+      if(r.flags & HAS_SCHEME)
+      {
+         result += _strings[r.handles[SCHEME]];
+         result += ':';
+      }
+      if(r.flags & HAS_AUTHORITY)
+      {
+         result += CHAR_CONTAINER('/');
+         result += CHAR_CONTAINER('/');
+         if(r.flags & HAS_USERINFO)
+         {
+            result += _strings[r.handles[USERINFO]];
+            result += '@';
+         }
+         result += _strings[r.handles[HOSTNAME]];
+         if(r.flags & HAS_PORT)
+         {
+            result += ':';
+            result += _strings[r.handles[PORT]];
+         }
+      }
+      for(std::size_t c = DIRECTORY; c < HANDLE_COUNT; ++c)
+         result += _strings[r.handles[c]];
+      return result;
+   }
+
+   basic_uri<CHAR_CONTAINER> get(intern_handle handle) const
+   {
+      return basic_uri<CHAR_CONTAINER>(to_string(handle));
+   }
+
+   private:
+   enum
+   {
+      SCHEME,
+      USERINFO,
+      HOSTNAME,
+      PORT,
+      DIRECTORY,
+      LEAF,
+      QUERY,
+      FRAGMENT,
+      HANDLE_COUNT
+   };
+
+   enum : std::uint8_t
+   {
+      HAS_SCHEME = 1,
+      HAS_AUTHORITY = 2,
+      HAS_USERINFO = 4,
+      HAS_PORT = 8
+   };
+
+   struct record
+   {
+      intern_handle handles[HANDLE_COUNT] = {};
+      std::uint8_t flags = 0;
+
+      bool operator==(const record& rhs) const
+      {
+         return flags == rhs.flags
+             && std::equal(handles, handles + HANDLE_COUNT, rhs.handles);
+      }
+   };
+
+   static std::uint32_t hash_of(const record& r)
+   {
+      uri_hasher hasher;
+      hasher.update(r.flags);
+      for(intern_handle h : r.handles)
+         hasher.update(h);
+      return fold_hash(hasher.value());
+   }
+
+   // HANDLE return the handle of a string, false if one is missing
+   template <typename HANDLE>
+   static bool make_record(const view_type& uri, record& r, const HANDLE& handle_of)
+   {
+      const string_view_type data = uri.data();
+      const uri_span authority = span_of(uri.offsets(), uri_component::authority);
+      const uri_span hostname = span_of(uri.offsets(), uri_component::hostname);
+      const uri_span userinfo = span_of(uri.offsets(), uri_component::userinfo);
+
+      if(data.size() > uri.scheme().size() && data[uri.scheme().size()] == ':')
+         r.flags |= HAS_SCHEME;
+      if(authority.offset >= 2 && data[authority.offset - 1] == '/'
+          && data[authority.offset - 2] == '/')
+         r.flags |= HAS_AUTHORITY;
+      if((r.flags & HAS_AUTHORITY) && hostname.offset > userinfo.offset + userinfo.length)
+         r.flags |= HAS_USERINFO;
+      if((r.flags & HAS_AUTHORITY)
+          && hostname.offset + hostname.length < authority.offset + authority.length)
+         r.flags |= HAS_PORT;
+
+      string_view_type path_view = uri.component(uri_component::path);
+      std::size_t last_slash = path_view.rfind('/');
+      std::size_t directory_size
+          = last_slash == string_view_type::npos ? 0 : last_slash + 1;
+
+      const string_view_type components[HANDLE_COUNT] = {uri.scheme(),
+          uri.userinfo(), uri.hostname(), uri.component(uri_component::port),
+          path_view.substr(0, directory_size), path_view.substr(directory_size),
+          uri.component(uri_component::query),
+          uri.component(uri_component::fragment)};
+
+      for(std::size_t c = 0; c < HANDLE_COUNT; ++c)
+      {
+         r.handles[c] = handle_of(components[c]);
+         if(r.handles[c] == intern_npos)
+            return false;
+      }
+      return true;
+   }
+
+   string_view_type component(intern_handle handle, std::size_t c) const
+   {
+      return _strings[_records[handle].handles[c]];
+   }
+
+   pool_type _strings;
+   basic_segmented_store<record> _records;
+   intern_index _index;
+   std::mutex _writer;
+};
+
+typedef basic_string_intern_pool<char> string_intern_pool;
+typedef basic_uri_intern_table<char> uri_intern_table;
+typedef basic_uri_intern_table<wchar_t> wuri_intern_table;
+}
+
+#endif //!URI_INTERN_HPP
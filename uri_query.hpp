@@ -0,0 +1,258 @@
+#ifndef URI_QUERY_HPP
+#define URI_QUERY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <vector>
+#include "uri.hpp"
+#include "uri_delimiters.hpp"
+
+namespace xts
+{
+// Vector keeping its first N elements inline, the heap is only used past N
+template <typename T, std::size_t N> class basic_inline_vector
+{
+   public:
+   T* data() { return _heap.empty() ? _inline.data() : _heap.data(); }
+   const T* data() const
+   {
+      return _heap.empty() ? _inline.data() : _heap.data();
+   }
+   std::size_t size() const { return _size; }
+   bool empty() const { return _size == 0; }
+
+   T& operator[](std::size_t i) { return data()[i]; }
+   const T& operator[](std::size_t i) const { return data()[i]; }
+
+   void clear()
+   {
+      _heap.clear();
+      _size = 0;
+   }
+
+   void push_back(const T& value)
+   {
+      if(_heap.empty() && _size < N)
+      {
+         _inline[_size++] = value;
+         return;
+      }
+      if(_heap.empty())
+      {
+         _heap.reserve(N * 2);
+         _heap.assign(_inline.begin(), _inline.end());
+      }
+      _heap.push_back(value);
+      ++_size;
+   }
+
+   // size copies of value
+   void assign(std::size_t size, const T& value)
+   {
+      _heap.clear();
+      if(size <= N)
+         std::fill(_inline.begin(), _inline.begin() + size, value);
+      else
+         _heap.assign(size, value);
+      _size = size;
+   }
+
+   private:
+   std::array<T, N> _inline{};
+   std::vector<T> _heap;
+   std::size_t _size = 0;
+};
+
+// Key/value pairs of a query, split once on '&' and '='
+// The pairs are kept in order and indexed by key in a flat open addressing
+// table, repeated keys are chained in order
+// Nothing is allocated up to INLINE_PARAMS pairs, the keys and values are
+// views on the query which must outlive the params, they are not decoded
+template <typename CHAR_CONTAINER, std::size_t INLINE_PARAMS = 16>
+class basic_query_params
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_view<CHAR_CONTAINER> view_type;
+
+   struct param
+   {
+      string_view_type key;
+      string_view_type value;
+   };
+
+   typedef const param* const_iterator;
+
+   // Walk the values of one key in the query order
+   class value_iterator
+   {
+      public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef string_view_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const string_view_type* pointer;
+      typedef const string_view_type& reference;
+
+      value_iterator() = default;
+      value_iterator(const basic_query_params* params, std::uint32_t index)
+          : _params(params), _index(index)
+      {
+      }
+
+      reference operator*() const { return _params->_params[_index].value; }
+      pointer operator->() const { return &operator*(); }
+
+      value_iterator& operator++()
+      {
+         _index = _params->_next[_index];
+         return *this;
+      }
+
+      value_iterator operator++(int)
+      {
+         value_iterator result = *this;
+         ++(*this);
+         return result;
+      }
+
+      bool operator==(const value_iterator& rhs) const
+      {
+         return _index == rhs._index;
+      }
+      bool operator!=(const value_iterator& rhs) const
+      {
+         return !operator==(rhs);
+      }
+
+      private:
+      const basic_query_params* _params = nullptr;
+      std::uint32_t _index = npos;
+   };
+
+   struct value_range
+   {
+      value_iterator first;
+      value_iterator begin() const { return first; }
+      value_iterator end() const { return value_iterator(); }
+   };
+
+   basic_query_params() = default;
+   basic_query_params(const basic_query_params&) = default;
+   basic_query_params(basic_query_params&&) = default;
+   basic_query_params& operator=(const basic_query_params&) = default;
+   basic_query_params& operator=(basic_query_params&&) = default;
+   ~basic_query_params() = default;
+
+   // the leading '?' of a query component is skipped
+   explicit basic_query_params(const string_view_type& query) { parse(query); }
+
+   explicit basic_query_params(const view_type& uri)
+   {
+      parse(uri.component(uri_component::query));
+   }
+
+   // Empty pairs are dropped, a pair without '=' has an empty value
+   void parse(const string_view_type& query)
+   {
+      _params.clear();
+      for_each_query_pair(query,
+          [this](const string_view_type& key, const string_view_type& value) {
+             _params.push_back(param{key, value});
+          });
+      build_index();
+   }
+
+   std::size_t size() const { return _params.size(); }
+   bool empty() const { return _params.empty(); }
+   const_iterator begin() const { return _params.data(); }
+   const_iterator end() const { return _params.data() + _params.size(); }
+   const param& operator[](std::size_t i) const { return _params[i]; }
+
+   // first pair of the key, nullptr if there is none
+   const param* find(const string_view_type& key) const
+   {
+      std::uint32_t index = first_of(key);
+      return index == npos ? nullptr : &_params[index];
+   }
+
+   bool contains(const string_view_type& key) const
+   {
+      return first_of(key) != npos;
+   }
+
+   // value of the first pair of the key, empty if there is none
+   string_view_type value(const string_view_type& key) const
+   {
+      std::uint32_t index = first_of(key);
+      return index == npos ? string_view_type() : _params[index].value;
+   }
+
+   value_range values(const string_view_type& key) const
+   {
+      return value_range{value_iterator(this, first_of(key))};
+   }
+
+   std::size_t count(const string_view_type& key) const
+   {
+      std::size_t result = 0;
+      for(std::uint32_t i = first_of(key); i != npos; i = _next[i])
+         ++result;
+      return result;
+   }
+
+   private:
+   static constexpr std::uint32_t npos = 0xFFFFFFFF;
+
+   static std::uint32_t hash_of(const string_view_type& key)
+   {
+      return fold_hash(hash_uri_data(key));
+   }
+
+   // the pairs are indexed backward so that every chain start at the first
+   // occurrence of its key
+   void build_index()
+   {
+      std::size_t capacity = 2;
+      while(capacity < _params.size() * 2)
+         capacity *= 2;
+      _slots.assign(capacity, npos);
+      _next.assign(_params.size(), npos);
+
+      const std::size_t mask = capacity - 1;
+      for(std::size_t i = _params.size(); i-- > 0;)
+      {
+         std::size_t s = hash_of(_params[i].key) & mask;
+         while(_slots[s] != npos && _params[_slots[s]].key != _params[i].key)
+            s = (s + 1) & mask;
+         _next[i] = _slots[s];
+         _slots[s] = static_cast<std::uint32_t>(i);
+      }
+   }
+
+   std::uint32_t first_of(const string_view_type& key) const
+   {
+      if(_params.empty())
+         return npos;
+      const std::size_t mask = _slots.size() - 1;
+      for(std::size_t s = hash_of(key) & mask;; s = (s + 1) & mask)
+      {
+         std::uint32_t index = _slots[s];
+         if(index == npos || _params[index].key == key)
+            return index;
+      }
+   }
+
+   basic_inline_vector<param, INLINE_PARAMS> _params;
+   basic_inline_vector<std::uint32_t, INLINE_PARAMS> _next;
+   basic_inline_vector<std::uint32_t, INLINE_PARAMS * 2> _slots;
+};
+
+typedef basic_query_params<char> query_params;
+typedef basic_query_params<wchar_t> wquery_params;
+}
+
+#endif //!URI_QUERY_HPP
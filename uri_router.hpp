@@ -0,0 +1,343 @@
+#ifndef URI_ROUTER_HPP
+#define URI_ROUTER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "uri.hpp"
+#include "uri_query.hpp"
+#include "uri_segment_trie.hpp"
+
+namespace xts
+{
+// Set of path patterns compiled into a deterministic automaton over the
+// segments of a path_tokenizer
+// A pattern segment is either a literal, a ":name" capturing one segment,
+// or a last "*name" capturing the remaining segments, possibly none
+// When several patterns match, the most specific win: segment by segment a
+// literal is preferred to a parameter and a parameter to a wildcard, the
+// first added pattern wins a tie
+// match() walk the path once without backtracking, the captures are views
+// on the path
+template <typename CHAR_CONTAINER, typename VALUE> class basic_route_table
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef basic_uri_tokenizer<CHAR_CONTAINER, '/'> path_tokenizer;
+
+   static constexpr std::uint32_t npos = 0xFFFFFFFF;
+
+   struct route
+   {
+      string_type pattern;
+      VALUE value;
+      // name of each capture in pattern order, the wildcard being the last
+      std::vector<string_type> names;
+      // depth of each parameter and of the wildcard, npos if there is none
+      std::vector<std::uint32_t> params;
+      std::uint32_t wildcard = npos;
+      // rank of the route by specificity
+      std::uint32_t order = 0;
+   };
+
+   struct route_match
+   {
+      const route* matched = nullptr;
+      basic_inline_vector<string_view_type, 8> captures;
+
+      explicit operator bool() const { return matched != nullptr; }
+
+      // capture of a parameter or of the wildcard, empty if there is none
+      string_view_type param(const string_view_type& name) const
+      {
+         if(matched == nullptr)
+            return string_view_type();
+         for(std::size_t i = 0; i < matched->names.size(); ++i)
+         {
+            if(matched->names[i] == name)
+               return captures[i];
+         }
+         return string_view_type();
+      }
+   };
+
+   basic_route_table(const basic_route_table&) = delete;
+   basic_route_table& operator=(const basic_route_table&) = delete;
+
+   // RANGE of pairs of a pattern and its value
+   template <typename RANGE> explicit basic_route_table(const RANGE& routes)
+   {
+      for(auto& r : routes)
+         add(string_view_type(r.first), r.second);
+      compile();
+   }
+
+   basic_route_table(
+       std::initializer_list<std::pair<string_view_type, VALUE>> routes)
+   {
+      for(auto& r : routes)
+         add(r.first, r.second);
+      compile();
+   }
+
+   std::size_t size() const { return _routes.size(); }
+   const route& operator[](std::size_t i) const { return _routes[i]; }
+   std::size_t state_count() const { return _states.size(); }
+
+   route_match match(const string_view_type& path) const
+   {
+      route_match result;
+      basic_inline_vector<string_view_type, 16> segments;
+      std::uint32_t state = 0;
+      std::uint32_t best = npos;
+      std::size_t rest = 0;
+
+      auto consider = [&](std::uint32_t candidate, std::size_t offset) {
+         if(candidate != npos
+             && (best == npos || _routes[candidate].order < _routes[best].order))
+         {
+            best = candidate;
+            rest = offset;
+         }
+      };
+
+      path_tokenizer tokenizer(path);
+      for(auto& segment : tokenizer)
+      {
+         consider(_states[state].wildcard,
+             static_cast<std::size_t>(segment.data() - path.data()));
+         segments.push_back(segment);
+         state = next(state, segment);
+         if(state == npos)
+            break;
+      }
+      if(state != npos)
+      {
+         consider(_states[state].terminal, path.size());
+         consider(_states[state].wildcard, path.size());
+      }
+
+      if(best == npos)
+         return result;
+      const route& r = _routes[best];
+      result.matched = &r;
+      for(std::uint32_t p : r.params)
+         result.captures.push_back(segments[p]);
+      if(r.wildcard != npos)
+         result.captures.push_back(path.substr(rest));
+      return result;
+   }
+
+   private:
+   enum : std::uint8_t
+   {
+      LITERAL,
+      PARAM,
+      WILDCARD
+   };
+
+   // kept by each node of the trie along its literal children
+   struct node_data
+   {
+      std::uint32_t param = npos;
+      std::vector<std::uint32_t> terminals;
+      std::vector<std::uint32_t> wildcards;
+   };
+
+   typedef basic_segment_trie<CHAR_CONTAINER, node_data> trie_type;
+   typedef basic_segment_edges<CHAR_CONTAINER> edges_type;
+   typedef typename trie_type::node node;
+
+   struct state
+   {
+      std::uint32_t first_edge = 0;
+      std::uint32_t edge_count = 0;
+      // taken by any segment without a literal edge
+      std::uint32_t any = npos;
+      std::uint32_t terminal = npos;
+      std::uint32_t wildcard = npos;
+   };
+
+   void add(const string_view_type& pattern, const VALUE& value)
+   {
+      _routes.push_back(route{string_type(pattern), value, {}, {}, npos, 0});
+      _kinds.emplace_back();
+      route& r = _routes.back();
+      std::vector<std::uint8_t>& kinds = _kinds.back();
+      const std::uint32_t index = static_cast<std::uint32_t>(_routes.size() - 1);
+
+      std::uint32_t current = 0;
+      std::uint32_t depth = 0;
+      path_tokenizer tokenizer(pattern);
+      for(auto it = tokenizer.begin(); it != tokenizer.end(); ++it, ++depth)
+      {
+         string_view_type segment = *it;
+         if(!segment.empty() && segment[0] == '*' && std::next(it) == tokenizer.end())
+         {
+            r.names.emplace_back(segment.substr(1));
+            r.wildcard = depth;
+            kinds.push_back(WILDCARD);
+            _trie[current].wildcards.push_back(index);
+            return;
+         }
+
+         if(!segment.empty() && segment[0] == ':')
+         {
+            r.names.emplace_back(segment.substr(1));
+            r.params.push_back(depth);
+            kinds.push_back(PARAM);
+            current = _trie.child(current, &node_data::param);
+         }
+         else
+         {
+            kinds.push_back(LITERAL);
+            current = _trie.literal(current, segment);
+         }
+      }
+      _trie[current].terminals.push_back(index);
+   }
+
+   // subset construction over the trie, a state being a set of nodes
+   void compile()
+   {
+      std::vector<std::uint32_t> by_kinds(_routes.size());
+      for(std::uint32_t i = 0; i < by_kinds.size(); ++i)
+         by_kinds[i] = i;
+      std::stable_sort(by_kinds.begin(), by_kinds.end(),
+          [this](std::uint32_t lhs, std::uint32_t rhs) {
+             return _kinds[lhs] < _kinds[rhs];
+          });
+      for(std::uint32_t i = 0; i < by_kinds.size(); ++i)
+         _routes[by_kinds[i]].order = i;
+
+      auto best_of = [this](std::uint32_t current, const std::vector<std::uint32_t>& candidates) {
+         for(std::uint32_t c : candidates)
+         {
+            if(current == npos || _routes[c].order < _routes[current].order)
+               current = c;
+         }
+         return current;
+      };
+
+      typedef std::vector<std::uint32_t> node_set;
+      std::map<node_set, std::uint32_t> known;
+      std::vector<node_set> pending;
+      auto state_of = [&](node_set set) {
+         if(set.empty())
+            return npos;
+         std::sort(set.begin(), set.end());
+         set.erase(std::unique(set.begin(), set.end()), set.end());
+         auto found = known.find(set);
+         if(found != known.end())
+            return found->second;
+         std::uint32_t id = static_cast<std::uint32_t>(_states.size());
+         _states.emplace_back();
+         known.emplace(set, id);
+         pending.push_back(std::move(set));
+         return id;
+      };
+
+      state_of(node_set{0});
+      for(std::uint32_t id = 0; id < _states.size(); ++id)
+      {
+         const node_set set = pending[id];
+         node_set params;
+         std::map<string_view_type, node_set> literals;
+         std::uint32_t terminal = npos;
+         std::uint32_t wildcard = npos;
+         for(std::uint32_t n : set)
+         {
+            const node& current = _trie[n];
+            if(current.param != npos)
+               params.push_back(current.param);
+            for(auto& l : current.literals)
+               literals[string_view_type(l.first)].push_back(l.second);
+            terminal = best_of(terminal, current.terminals);
+            wildcard = best_of(wildcard, current.wildcards);
+         }
+
+         const std::uint32_t first_edge = _edges.size();
+         for(auto& l : literals)
+         {
+            node_set targets = l.second;
+            targets.insert(targets.end(), params.begin(), params.end());
+            _edges.push_back(l.first, state_of(std::move(targets)));
+         }
+         std::uint32_t any = state_of(params);
+
+         state& s = _states[id];
+         s.first_edge = first_edge;
+         s.edge_count = static_cast<std::uint32_t>(literals.size());
+         s.any = any;
+         s.terminal = terminal;
+         s.wildcard = wildcard;
+      }
+
+      _trie.clear();
+      _kinds = std::vector<std::vector<std::uint8_t>>();
+   }
+
+   // the edges of a state are sorted by segment
+   std::uint32_t next(std::uint32_t id, const string_view_type& segment) const
+   {
+      const state& s = _states[id];
+      const auto* found = _edges.find(s.first_edge, s.edge_count, segment);
+      return found != nullptr ? found->next : s.any;
+   }
+
+   std::vector<route> _routes;
+   std::vector<state> _states;
+   edges_type _edges;
+
+   // only used while compiling
+   trie_type _trie;
+   std::vector<std::vector<std::uint8_t>> _kinds;
+};
+
+// Route table that can be replaced while it is matched
+// table() pin the current table, assign() publish a new one, the previous
+// table is released once its last reader drop it
+template <typename CHAR_CONTAINER, typename VALUE> class basic_router
+{
+   public:
+   typedef basic_route_table<CHAR_CONTAINER, VALUE> table_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   basic_router() = default;
+   basic_router(const basic_router&) = delete;
+   basic_router& operator=(const basic_router&) = delete;
+
+   explicit basic_router(std::shared_ptr<const table_type> table)
+       : _table(std::move(table))
+   {
+   }
+
+   std::shared_ptr<const table_type> table() const
+   {
+      return std::atomic_load(&_table);
+   }
+
+   void assign(std::shared_ptr<const table_type> table)
+   {
+      std::atomic_store(&_table, std::move(table));
+   }
+
+   private:
+   std::shared_ptr<const table_type> _table;
+};
+
+template <typename VALUE> using route_table = basic_route_table<char, VALUE>;
+template <typename VALUE> using wroute_table = basic_route_table<wchar_t, VALUE>;
+template <typename VALUE> using router = basic_router<char, VALUE>;
+template <typename VALUE> using wrouter = basic_router<wchar_t, VALUE>;
+}
+
+#endif //!URI_ROUTER_HPP
@@ -0,0 +1,126 @@
+#ifndef URI_SEGMENT_TRIE_HPP
+#define URI_SEGMENT_TRIE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xts
+{
+// Trie over the segments of patterns, built by the route tables and the glob
+// sets before they compile it
+// NODE holds what each of them keep per node, the trie adds the literal
+// children; the other children are kept in members of NODE, see child()
+template <typename CHAR_CONTAINER, typename NODE> class basic_segment_trie
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   static constexpr std::uint32_t npos = 0xFFFFFFFF;
+
+   struct node : NODE
+   {
+      std::map<string_type, std::uint32_t> literals;
+   };
+
+   // the root is the node 0
+   basic_segment_trie() : _nodes(1) {}
+
+   std::size_t size() const { return _nodes.size(); }
+   node& operator[](std::uint32_t id) { return _nodes[id]; }
+   const node& operator[](std::uint32_t id) const { return _nodes[id]; }
+
+   std::uint32_t new_node()
+   {
+      _nodes.emplace_back();
+      return static_cast<std::uint32_t>(_nodes.size() - 1);
+   }
+
+   // child of id through a literal segment, added if missing
+   std::uint32_t literal(std::uint32_t id, const string_view_type& segment)
+   {
+      auto found = _nodes[id].literals.find(string_type(segment));
+      if(found != _nodes[id].literals.end())
+         return found->second;
+      const std::uint32_t child = new_node();
+      _nodes[id].literals.emplace(string_type(segment), child);
+      return child;
+   }
+
+   // child of id kept in a member of NODE, npos when missing, added if missing
+   std::uint32_t child(std::uint32_t id, std::uint32_t NODE::*member)
+   {
+      std::uint32_t result = _nodes[id].*member;
+      if(result == npos)
+      {
+         result = new_node();
+         _nodes[id].*member = result;
+      }
+      return result;
+   }
+
+   // the nodes are only needed until compiled
+   void clear() { _nodes = std::vector<node>(); }
+
+   private:
+   std::vector<node> _nodes;
+};
+
+// Edges of a compiled automaton labelled by segments, the labels are packed
+// in one string
+// The edges leaving a state are pushed together, sorted by label
+template <typename CHAR_CONTAINER> class basic_segment_edges
+{
+   public:
+   typedef std::basic_string<CHAR_CONTAINER> string_type;
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   struct edge
+   {
+      std::uint32_t offset;
+      std::uint32_t length;
+      std::uint32_t next;
+   };
+
+   std::uint32_t size() const { return static_cast<std::uint32_t>(_edges.size()); }
+   const edge* data() const { return _edges.data(); }
+
+   void push_back(const string_view_type& label, std::uint32_t next)
+   {
+      _edges.push_back(edge{static_cast<std::uint32_t>(_labels.size()),
+          static_cast<std::uint32_t>(label.size()), next});
+      _labels.append(label.data(), label.size());
+   }
+
+   string_view_type label(const edge& e) const
+   {
+      return string_view_type(_labels.data() + e.offset, e.length);
+   }
+
+   // edge labelled segment among the count edges from first, nullptr if none
+   const edge* find(std::uint32_t first, std::uint32_t count,
+       const string_view_type& segment) const
+   {
+      const edge* beg = _edges.data() + first;
+      const edge* end = beg + count;
+      const edge* found = std::lower_bound(beg, end, segment,
+          [this](const edge& e, const string_view_type& key) {
+             return label(e) < key;
+          });
+      if(found != end && label(*found) == segment)
+         return found;
+      return nullptr;
+   }
+
+   private:
+   std::vector<edge> _edges;
+   string_type _labels;
+};
+}
+
+#endif //!URI_SEGMENT_TRIE_HPP
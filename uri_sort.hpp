@@ -0,0 +1,327 @@
+#ifndef URI_SORT_HPP
+#define URI_SORT_HPP
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "uri.hpp"
+
+namespace xts
+{
+template <typename CHAR_CONTAINER>
+std::basic_string_view<CHAR_CONTAINER> sort_key_of(
+    const basic_uri<CHAR_CONTAINER>& uri)
+{
+   return uri.data();
+}
+
+template <typename CHAR_CONTAINER>
+std::basic_string_view<CHAR_CONTAINER> sort_key_of(
+    const basic_uri_view<CHAR_CONTAINER>& uri)
+{
+   return uri.data();
+}
+
+// Order of uris and views by their data, characters compared as unsigned
+// It is the order of operator< and of radix_sort_uris, normalize the uris
+// first to sort equivalent uris together
+struct uri_data_less
+{
+   template <typename LHS, typename RHS>
+   bool operator()(const LHS& lhs, const RHS& rhs) const
+   {
+      return sort_key_of(lhs) < sort_key_of(rhs);
+   }
+};
+
+struct uri_data_equal
+{
+   template <typename LHS, typename RHS>
+   bool operator()(const LHS& lhs, const RHS& rhs) const
+   {
+      return sort_key_of(lhs) == sort_key_of(rhs);
+   }
+};
+
+// Stable MSD radix sort of uri data, one character per level
+// Only the keys and the indices are moved, order() gives the permutation
+// With several threads the large buckets of every level are shared between
+// the workers
+template <typename CHAR_CONTAINER> class basic_uri_radix_sorter
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   explicit basic_uri_radix_sorter(std::size_t threads = 1)
+       : _threads((std::max)(threads, std::size_t(1)))
+   {
+   }
+
+   // order[i] is the index in keys of the i-th smallest key
+   std::vector<std::size_t> order(const std::vector<string_view_type>& keys) const
+   {
+      std::vector<entry> entries(keys.size());
+      for(std::size_t i = 0; i < keys.size(); ++i)
+         entries[i] = entry{keys[i], i};
+      std::vector<entry> buffer(entries.size());
+      sort(entries.data(), buffer.data(), entries.size());
+
+      std::vector<std::size_t> result(entries.size());
+      for(std::size_t i = 0; i < entries.size(); ++i)
+         result[i] = entries[i].index;
+      return result;
+   }
+
+   private:
+   typedef typename std::make_unsigned<CHAR_CONTAINER>::type unsigned_type;
+
+   // bucket 0 hold the keys ending at the current depth, the last one the
+   // wide characters above 255, sorted by comparison
+   static constexpr std::size_t WIDE_BUCKET = 257;
+   static constexpr std::size_t BUCKET_COUNT = sizeof(CHAR_CONTAINER) == 1 ? 257 : 258;
+   static constexpr std::size_t SMALL_RANGE = 32;
+   // buckets handed to the other workers
+   static constexpr std::size_t PARALLEL_RANGE = 4096;
+
+   struct entry
+   {
+      string_view_type key;
+      std::size_t index;
+   };
+
+   static std::size_t bucket_of(const entry& e, std::size_t depth)
+   {
+      if(depth >= e.key.size())
+         return 0;
+      const unsigned_type c = static_cast<unsigned_type>(e.key[depth]);
+      return c < 256 ? static_cast<std::size_t>(c) + 1 : WIDE_BUCKET;
+   }
+
+   static bool less_from(const entry& lhs, const entry& rhs, std::size_t depth)
+   {
+      return std::lexicographical_compare(lhs.key.begin() + depth, lhs.key.end(),
+          rhs.key.begin() + depth, rhs.key.end(),
+          [](CHAR_CONTAINER l, CHAR_CONTAINER r) {
+             return static_cast<unsigned_type>(l) < static_cast<unsigned_type>(r);
+          });
+   }
+
+   // every key of the range share its first depth characters
+   static void compare_sort(entry* first, std::size_t size, std::size_t depth)
+   {
+      std::stable_sort(first, first + size, [depth](const entry& lhs, const entry& rhs) {
+         return less_from(lhs, rhs, depth);
+      });
+   }
+
+   // keys of [first, first + size) of the entries share depth characters
+   struct range
+   {
+      std::size_t first;
+      std::size_t size;
+      std::size_t depth;
+   };
+
+   // ranges waiting for a worker, and the number of workers splitting one
+   struct shared_ranges
+   {
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::vector<range> ranges;
+      std::size_t busy = 0;
+   };
+
+   // The levels are walked from an explicit stack, the depth of the keys
+   // doesn't grow the call stack
+   void sort(entry* entries, entry* buffer, std::size_t size) const
+   {
+      if(_threads == 1)
+      {
+         std::vector<range> pending{range{0, size, 0}};
+         while(!pending.empty())
+         {
+            range r = pending.back();
+            pending.pop_back();
+            split(entries, buffer, r, pending, nullptr);
+         }
+         return;
+      }
+
+      shared_ranges shared;
+      shared.ranges.push_back(range{0, size, 0});
+      auto work = [&]() {
+         std::vector<range> pending;
+         for(;;)
+         {
+            {
+               std::unique_lock<std::mutex> lock(shared.mutex);
+               shared.ready.wait(lock, [&shared]() {
+                  return !shared.ranges.empty() || shared.busy == 0;
+               });
+               if(shared.ranges.empty())
+                  return;
+               pending.push_back(shared.ranges.back());
+               shared.ranges.pop_back();
+               ++shared.busy;
+            }
+            while(!pending.empty())
+            {
+               range r = pending.back();
+               pending.pop_back();
+               split(entries, buffer, r, pending, &shared);
+            }
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if(--shared.busy == 0 && shared.ranges.empty())
+               shared.ready.notify_all();
+         }
+      };
+      std::vector<std::thread> workers;
+      for(std::size_t t = 1; t < _threads; ++t)
+         workers.emplace_back(work);
+      work();
+      for(auto& worker : workers)
+         worker.join();
+   }
+
+   // Distribute one range on its next distinct character, the buckets left
+   // to sort are pushed on pending, or shared with the other workers when
+   // they are large
+   void split(entry* entries, entry* buffer, range r, std::vector<range>& pending,
+       shared_ranges* shared) const
+   {
+      entry* first = entries + r.first;
+      std::array<std::size_t, BUCKET_COUNT + 1> bounds;
+      for(;;)
+      {
+         if(r.size <= SMALL_RANGE)
+         {
+            compare_sort(first, r.size, r.depth);
+            return;
+         }
+
+         bounds.fill(0);
+         for(std::size_t i = 0; i < r.size; ++i)
+            ++bounds[bucket_of(first[i], r.depth) + 1];
+         // a common character doesn't need a pass
+         const std::size_t common = bucket_of(first[0], r.depth);
+         if(common != 0 && bounds[common + 1] == r.size)
+         {
+            if(common == WIDE_BUCKET)
+            {
+               compare_sort(first, r.size, r.depth);
+               return;
+            }
+            ++r.depth;
+            continue;
+         }
+         break;
+      }
+
+      for(std::size_t b = 1; b <= BUCKET_COUNT; ++b)
+         bounds[b] += bounds[b - 1];
+      std::array<std::size_t, BUCKET_COUNT + 1> next = bounds;
+      entry* scattered = buffer + r.first;
+      for(std::size_t i = 0; i < r.size; ++i)
+         scattered[next[bucket_of(first[i], r.depth)]++] = first[i];
+      std::copy(scattered, scattered + r.size, first);
+
+      // the keys of bucket 0 end here and are equal
+      for(std::size_t b = 1; b < BUCKET_COUNT; ++b)
+      {
+         const std::size_t count = bounds[b + 1] - bounds[b];
+         if(count < 2)
+            continue;
+         if(b == WIDE_BUCKET)
+         {
+            compare_sort(first + bounds[b], count, r.depth);
+            continue;
+         }
+         const range bucket{r.first + bounds[b], count, r.depth + 1};
+         if(shared != nullptr && count >= PARALLEL_RANGE)
+         {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->ranges.push_back(bucket);
+            shared->ready.notify_one();
+         }
+         else
+            pending.push_back(bucket);
+      }
+   }
+
+   std::size_t _threads;
+};
+
+// indices of the uris in [first, last) in sorted order
+template <typename RANDOM_IT>
+std::vector<std::size_t> radix_sort_order(
+    RANDOM_IT first, RANDOM_IT last, std::size_t threads = 1)
+{
+   typedef decltype(sort_key_of(*first)) string_view_type;
+   typedef typename string_view_type::value_type char_type;
+
+   std::vector<string_view_type> keys;
+   keys.reserve(static_cast<std::size_t>(std::distance(first, last)));
+   for(RANDOM_IT it = first; it != last; ++it)
+      keys.push_back(sort_key_of(*it));
+   return basic_uri_radix_sorter<char_type>(threads).order(keys);
+}
+
+// Sort [first, last) by uri_data_less, stable
+// The order is computed on the keys, then each uri is moved once
+template <typename RANDOM_IT>
+void radix_sort_uris(RANDOM_IT first, RANDOM_IT last, std::size_t threads = 1)
+{
+   std::vector<std::size_t> order = radix_sort_order(first, last, threads);
+   const std::size_t npos = static_cast<std::size_t>(-1);
+   for(std::size_t i = 0; i < order.size(); ++i)
+   {
+      if(order[i] == npos || order[i] == i)
+         continue;
+      auto value = std::move(first[i]);
+      std::size_t j = i;
+      while(order[j] != i)
+      {
+         first[j] = std::move(first[order[j]]);
+         const std::size_t from = order[j];
+         order[j] = npos;
+         j = from;
+      }
+      first[j] = std::move(value);
+      order[j] = npos;
+   }
+}
+
+// The following operations expect ranges sorted by uri_data_less
+
+template <typename INPUT_IT1, typename INPUT_IT2, typename OUTPUT_IT>
+OUTPUT_IT merge_sorted_uris(INPUT_IT1 first1, INPUT_IT1 last1,
+    INPUT_IT2 first2, INPUT_IT2 last2, OUTPUT_IT out)
+{
+   return std::merge(first1, last1, first2, last2, out, uri_data_less());
+}
+
+// keep the first of each run of identical uris, return the new end
+template <typename FORWARD_IT>
+FORWARD_IT unique_sorted_uris(FORWARD_IT first, FORWARD_IT last)
+{
+   return std::unique(first, last, uri_data_equal());
+}
+
+// uris of the first range missing from the second
+template <typename INPUT_IT1, typename INPUT_IT2, typename OUTPUT_IT>
+OUTPUT_IT set_difference_sorted_uris(INPUT_IT1 first1, INPUT_IT1 last1,
+    INPUT_IT2 first2, INPUT_IT2 last2, OUTPUT_IT out)
+{
+   return std::set_difference(first1, last1, first2, last2, out, uri_data_less());
+}
+}
+
+#endif //!URI_SORT_HPP
@@ -0,0 +1,272 @@
+#ifndef URI_STREAM_HPP
+#define URI_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "uri.hpp"
+#include "uri_delimiters.hpp"
+
+namespace xts
+{
+// Push parser computing the same offsets as parse_uri_offsets from an uri
+// received in any number of chunks, nothing is copied nor buffered
+// Only the structural delimitors of each chunk are visited, the parser
+// resume from its state at the next chunk
+// The offsets are positions in the concatenation of the chunks, they are
+// complete once finish() is called
+template <typename CHAR_CONTAINER> class basic_uri_stream_parser
+{
+   public:
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   basic_uri_stream_parser() = default;
+   basic_uri_stream_parser(const basic_uri_stream_parser&) = default;
+   basic_uri_stream_parser(basic_uri_stream_parser&&) = default;
+   basic_uri_stream_parser& operator=(const basic_uri_stream_parser&) = default;
+   basic_uri_stream_parser& operator=(basic_uri_stream_parser&&) = default;
+   ~basic_uri_stream_parser() = default;
+
+   void feed(const string_view_type& chunk)
+   {
+      typedef basic_delimiter_scanner<CHAR_CONTAINER, ':', '/', '?', '#', '@',
+          '[', ']'>
+          scanner_type;
+
+      scanner_type scanner(chunk);
+      for(std::size_t d = scanner.peek(); d < chunk.size(); d = scanner.peek())
+      {
+         on_delimitor(chunk[d], static_cast<pos_type>(_size + d));
+         scanner.pop();
+      }
+      _size += static_cast<pos_type>(chunk.size());
+   }
+
+   // the uri is complete, the pending components end with it
+   const uri_offsets& finish()
+   {
+      if(_state == state::finished)
+         return _offsets;
+      if(_state == state::scheme || _state == state::authority_slash
+          || _state == state::authority_second_slash)
+         start_path(_pos);
+      if(_state == state::authority)
+      {
+         end_authority(_size);
+         start_path(_size);
+      }
+      if(_state == state::path)
+         end_path(_size);
+      if(_state == state::query)
+         end_query(_size);
+      set(uri_component::fragment, _fragment_beg, _size);
+      _state = state::finished;
+      return _offsets;
+   }
+
+   void reset() { *this = basic_uri_stream_parser(); }
+
+   bool finished() const { return _state == state::finished; }
+   // characters fed so far
+   std::size_t size() const { return _size; }
+   const uri_offsets& offsets() const { return _offsets; }
+
+   private:
+   typedef std::uint32_t pos_type;
+   static constexpr pos_type npos = 0xFFFFFFFF;
+
+   enum class state : std::uint8_t
+   {
+      scheme,
+      authority_slash,
+      authority_second_slash,
+      authority,
+      path,
+      query,
+      fragment,
+      finished
+   };
+
+   void set(uri_component c, pos_type beg, pos_type end)
+   {
+      span_of(_offsets, c) = uri_span{beg, end - beg};
+   }
+
+   void on_delimitor(CHAR_CONTAINER c, pos_type i)
+   {
+      switch(_state)
+      {
+      case state::scheme:
+         if(c == ':')
+         {
+            set(uri_component::scheme, 0, i);
+            _pos = i + 1;
+            _state = state::authority_slash;
+         }
+         else if(c == '/' || c == '?' || c == '#')
+         {
+            _pos = 0;
+            _state = state::authority_slash;
+            on_delimitor(c, i);
+         }
+         break;
+      case state::authority_slash:
+         if(c == '/' && i == _pos)
+            _state = state::authority_second_slash;
+         else
+         {
+            start_path(_pos);
+            on_delimitor(c, i);
+         }
+         break;
+      case state::authority_second_slash:
+         if(c == '/' && i == _pos + 1)
+         {
+            _authority_beg = i + 1;
+            _host_beg = i + 1;
+            _state = state::authority;
+         }
+         else
+         {
+            start_path(_pos);
+            on_delimitor(c, i);
+         }
+         break;
+      case state::authority:
+         on_authority_delimitor(c, i);
+         break;
+      case state::path:
+         if(c == '?')
+            end_path(i);
+         else if(c == '#')
+         {
+            end_path(i);
+            end_query(i);
+         }
+         break;
+      case state::query:
+         if(c == '#')
+            end_query(i);
+         break;
+      case state::fragment:
+      case state::finished:
+         break;
+      }
+   }
+
+   void on_authority_delimitor(CHAR_CONTAINER c, pos_type i)
+   {
+      if(c == '/' || c == '?' || c == '#')
+      {
+         end_authority(i);
+         start_path(i);
+         on_delimitor(c, i);
+      }
+      else if(c == '@' && _at == npos)
+      {
+         _at = i;
+         _host_colon = npos;
+         _host_beg = i + 1;
+         _bracket = false;
+         _close = npos;
+         _close_colon = false;
+      }
+      else if(c == ':')
+      {
+         if(_first_colon == npos)
+            _first_colon = i;
+         if(_host_colon == npos)
+            _host_colon = i;
+         if(_close != npos && i == _close + 1)
+            _close_colon = true;
+      }
+      else if(c == '[' && i == _host_beg)
+         _bracket = true;
+      else if(c == ']' && _bracket && _close == npos)
+         _close = i;
+   }
+
+   void end_authority(pos_type end)
+   {
+      const pos_type beg = _authority_beg;
+      set(uri_component::authority, beg, end);
+      if(_at != npos)
+      {
+         set(uri_component::userinfo, beg, _at);
+         if(_first_colon < _at)
+         {
+            set(uri_component::user, beg, _first_colon);
+            set(uri_component::password, _first_colon + 1, _at);
+         }
+         else
+         {
+            set(uri_component::user, beg, _at);
+            set(uri_component::password, _at, _at);
+         }
+      }
+      else
+      {
+         set(uri_component::userinfo, beg, beg);
+         set(uri_component::user, beg, beg);
+         set(uri_component::password, beg, beg);
+      }
+
+      pos_type host_colon = _host_colon;
+      if(_bracket)
+         host_colon = _close_colon ? _close + 1 : npos;
+      if(host_colon != npos)
+      {
+         set(uri_component::hostname, _host_beg, host_colon);
+         set(uri_component::port, host_colon + 1, end);
+      }
+      else
+      {
+         set(uri_component::hostname, _host_beg, end);
+         set(uri_component::port, end, end);
+      }
+   }
+
+   void start_path(pos_type beg)
+   {
+      _pos = beg;
+      _state = state::path;
+   }
+
+   void end_path(pos_type end)
+   {
+      set(uri_component::path, _pos, end);
+      _pos = end;
+      _state = state::query;
+   }
+
+   // the query start at _pos, possibly empty
+   void end_query(pos_type end)
+   {
+      set(uri_component::query, _pos, end);
+      _fragment_beg = end;
+      _state = state::fragment;
+   }
+
+   uri_offsets _offsets{};
+   state _state = state::scheme;
+   pos_type _size = 0;
+   // start of the component being parsed
+   pos_type _pos = 0;
+   pos_type _fragment_beg = 0;
+
+   // authority delimitors, as located by parse_uri_offsets
+   pos_type _authority_beg = 0;
+   pos_type _host_beg = 0;
+   pos_type _at = npos;
+   pos_type _first_colon = npos;
+   pos_type _host_colon = npos;
+   pos_type _close = npos;
+   bool _bracket = false;
+   bool _close_colon = false;
+};
+
+typedef basic_uri_stream_parser<char> uri_stream_parser;
+typedef basic_uri_stream_parser<wchar_t> wuri_stream_parser;
+}
+
+#endif //!URI_STREAM_HPP
@@ -0,0 +1,148 @@
+#ifndef URI_VISITOR_HPP
+#define URI_VISITOR_HPP
+
+#include <string_view>
+#include <type_traits>
+#include "uri.hpp"
+
+namespace xts
+{
+// Callbacks of visit_uri, all doing nothing
+// Derive from it and hide the callbacks of interest, they are resolved at
+// compile time and visit_uri skips the others
+template <typename CHAR_CONTAINER> struct basic_uri_visitor
+{
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+
+   void on_scheme(const string_view_type&) {}
+   void on_userinfo(const string_view_type&) {}
+   void on_host(const string_view_type&) {}
+   void on_port(const string_view_type&) {}
+   void on_path_segment(const string_view_type&) {}
+   void on_query_param(const string_view_type&, const string_view_type&) {}
+   void on_fragment(const string_view_type&) {}
+};
+
+// A callback is overridden when VISITOR hides the one of basic_uri_visitor,
+// the callbacks must not be overloaded
+template <typename MEMBER, typename BASE_MEMBER>
+constexpr bool overrides_visitor_callback(MEMBER, BASE_MEMBER)
+{
+   return !std::is_same<MEMBER, BASE_MEMBER>::value;
+}
+
+// Parse policy computing only the components VISITOR is called with
+template <typename VISITOR, typename CHAR_CONTAINER> class uri_visitor_parse
+{
+   typedef basic_uri_visitor<CHAR_CONTAINER> base;
+
+   template <typename POLICY, bool NEEDED, uri_component C> struct add
+   {
+      typedef POLICY type;
+   };
+
+   template <uri_component... COMPONENTS, uri_component C>
+   struct add<uri_parse_policy<COMPONENTS...>, true, C>
+   {
+      typedef uri_parse_policy<COMPONENTS..., C> type;
+   };
+
+   typedef typename add<uri_parse_policy<>,
+       overrides_visitor_callback(&VISITOR::on_scheme, &base::on_scheme),
+       uri_component::scheme>::type scheme;
+   typedef typename add<scheme,
+       overrides_visitor_callback(&VISITOR::on_userinfo, &base::on_userinfo),
+       uri_component::userinfo>::type userinfo;
+   typedef typename add<userinfo,
+       overrides_visitor_callback(&VISITOR::on_host, &base::on_host),
+       uri_component::hostname>::type hostname;
+   typedef typename add<hostname,
+       overrides_visitor_callback(&VISITOR::on_port, &base::on_port),
+       uri_component::port>::type port;
+   typedef typename add<port,
+       overrides_visitor_callback(&VISITOR::on_path_segment, &base::on_path_segment),
+       uri_component::path>::type path;
+   typedef typename add<path,
+       overrides_visitor_callback(&VISITOR::on_query_param, &base::on_query_param),
+       uri_component::query>::type query;
+
+   public:
+   typedef typename add<query,
+       overrides_visitor_callback(&VISITOR::on_fragment, &base::on_fragment),
+       uri_component::fragment>::type type;
+};
+
+// Walk an already parsed uri and report its components in order
+// Empty components are not reported, except the path segments which are
+// cut by path_tokenizer and the query parameters by for_each_query_pair
+// The fragment is reported without its '#', the port as written
+// The callbacks VISITOR doesn't override are skipped at compile time, the
+// path and the query are only split for on_path_segment and on_query_param
+template <typename CHAR_CONTAINER, typename VISITOR>
+void visit_uri(const basic_uri_view<CHAR_CONTAINER>& uri, VISITOR& visitor)
+{
+   typedef std::basic_string_view<CHAR_CONTAINER> string_view_type;
+   typedef typename uri_visitor_parse<VISITOR, CHAR_CONTAINER>::type policy;
+
+   if constexpr(policy::needs(uri_component::scheme))
+   {
+      const string_view_type scheme = uri.component(uri_component::scheme);
+      if(!scheme.empty())
+         visitor.on_scheme(scheme);
+   }
+   if constexpr(policy::needs(uri_component::userinfo))
+   {
+      const string_view_type userinfo = uri.component(uri_component::userinfo);
+      if(!userinfo.empty())
+         visitor.on_userinfo(userinfo);
+   }
+   if constexpr(policy::needs(uri_component::hostname))
+   {
+      const string_view_type host = uri.component(uri_component::hostname);
+      if(!host.empty())
+         visitor.on_host(host);
+   }
+   if constexpr(policy::needs(uri_component::port))
+   {
+      const string_view_type port = uri.component(uri_component::port);
+      if(!port.empty())
+         visitor.on_port(port);
+   }
+   if constexpr(policy::needs(uri_component::path))
+   {
+      for(const string_view_type& segment : uri.paths())
+         visitor.on_path_segment(segment);
+   }
+   if constexpr(policy::needs(uri_component::query))
+   {
+      for_each_query_pair(uri.component(uri_component::query),
+          [&visitor](const string_view_type& key, const string_view_type& value) {
+             visitor.on_query_param(key, value);
+          });
+   }
+   if constexpr(policy::needs(uri_component::fragment))
+   {
+      string_view_type fragment = uri.component(uri_component::fragment);
+      if(!fragment.empty() && fragment.front() == '#')
+         fragment.remove_prefix(1);
+      if(!fragment.empty())
+         visitor.on_fragment(fragment);
+   }
+}
+
+// Parse and walk data in the same call, the parse only computes the
+// components of the overridden callbacks and stops after the last one
+template <typename CHAR_CONTAINER, typename VISITOR>
+void visit_uri(std::basic_string_view<CHAR_CONTAINER> data, VISITOR& visitor)
+{
+   typedef typename uri_visitor_parse<VISITOR, CHAR_CONTAINER>::type policy;
+   visit_uri(basic_uri_view<CHAR_CONTAINER>(
+                 data, partial_parse_uri_offsets<policy>(data)),
+       visitor);
+}
+
+typedef basic_uri_visitor<char> uri_visitor;
+typedef basic_uri_visitor<wchar_t> wuri_visitor;
+}
+
+#endif //!URI_VISITOR_HPP